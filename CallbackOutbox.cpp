@@ -0,0 +1,120 @@
+#include "CallbackOutbox.h"
+#include "PerfStats.h"
+
+using namespace json11;
+
+CallbackOutbox::~CallbackOutbox()
+{
+	stop();
+}
+
+void CallbackOutbox::start(SendFunc send)
+{
+	std::lock_guard<std::mutex> grd(m_mtx);
+
+	if (m_running)
+		return;
+
+	m_send = std::move(send);
+	m_running = true;
+	m_thread = std::thread(&CallbackOutbox::senderThread, this);
+}
+
+void CallbackOutbox::stop()
+{
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+		m_running = false;
+	}
+
+	m_workCv.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	m_roomCv.notify_all();
+}
+
+bool CallbackOutbox::hasRoom(const size_t bytes) const
+{
+	// An empty outbox always takes the next entry, however large, or it could never be sent
+	if (m_queue.empty())
+		return true;
+
+	return m_queue.size() < kMaxDepth && m_bytes + bytes <= kMaxBytes;
+}
+
+void CallbackOutbox::push(const int functionId, std::string jsonStr)
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	if (!m_running)
+	{
+		lock.unlock();
+
+		if (m_send)
+			m_send(functionId, std::move(jsonStr));
+
+		return;
+	}
+
+	const size_t bytes = jsonStr.size();
+
+	if (!hasRoom(bytes))
+	{
+		const uint64_t blockStart = PerfStats::now();
+		m_roomCv.wait(lock, [this, bytes] { return hasRoom(bytes) || !m_running; });
+
+		++m_blocked;
+		m_blockedNs += PerfStats::now() - blockStart;
+	}
+
+	m_queue.push_back({functionId, std::move(jsonStr)});
+	m_bytes += bytes;
+
+	if (m_queue.size() > m_peakDepth)
+		m_peakDepth = m_queue.size();
+
+	lock.unlock();
+	m_workCv.notify_one();
+}
+
+void CallbackOutbox::senderThread()
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	while (true)
+	{
+		m_workCv.wait(lock, [this] { return !m_queue.empty() || !m_running; });
+
+		if (m_queue.empty())
+			return;
+
+		Entry entry = std::move(m_queue.front());
+		m_queue.pop_front();
+
+		// Room is only given back once the entry is out, so bytes covers what is held in memory
+		const size_t bytes = entry.jsonStr.size();
+
+		lock.unlock();
+		const bool sent = m_send(entry.functionId, std::move(entry.jsonStr));
+		lock.lock();
+
+		m_bytes -= bytes;
+		++(sent ? m_sent : m_failed);
+		m_roomCv.notify_all();
+	}
+}
+
+Json CallbackOutbox::stats() const
+{
+	std::lock_guard<std::mutex> grd(m_mtx);
+
+	return Json::object{{"depth", double(m_queue.size())},
+			    {"bytes", double(m_bytes)},
+			    {"peak_depth", double(m_peakDepth)},
+			    {"sent", double(m_sent)},
+			    {"failed", double(m_failed)},
+			    {"blocked", double(m_blocked)},
+			    {"blocked_ms", double(m_blockedNs) / 1000000.0}};
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <json11/json11.hpp>
+
+// Callback results on their way to the browser, drained in order by one sender thread so API workers never wait on IPC
+// Bounded by count and bytes, a full outbox blocks the pushing worker until the sender catches up
+class CallbackOutbox
+{
+public:
+	// Owns the string, it can be moved straight into the outgoing message
+	using SendFunc = std::function<bool(const int functionId, std::string jsonStr)>;
+
+	static constexpr size_t kMaxDepth = 256;
+	static constexpr size_t kMaxBytes = 64 * 1024 * 1024;
+
+	~CallbackOutbox();
+
+	void start(SendFunc send);
+
+	// Whatever is already queued is still sent before the sender exits
+	void stop();
+
+	// Sends inline if the sender isn't running
+	void push(const int functionId, std::string jsonStr);
+
+	// { "depth": 0, "bytes": 0, "peak_depth": 0, "sent": 0, "failed": 0, "blocked": 0, "blocked_ms": 0.0 }
+	json11::Json stats() const;
+
+private:
+	struct Entry
+	{
+		int functionId = 0;
+		std::string jsonStr;
+	};
+
+	void senderThread();
+	bool hasRoom(const size_t bytes) const;
+
+	SendFunc m_send;
+	std::thread m_thread;
+	bool m_running = false;
+
+	mutable std::mutex m_mtx;
+	std::condition_variable m_workCv;
+	std::condition_variable m_roomCv;
+	std::deque<Entry> m_queue;
+	size_t m_bytes = 0;
+
+	size_t m_peakDepth = 0;
+	uint64_t m_sent = 0;
+	uint64_t m_failed = 0;
+	uint64_t m_blocked = 0;
+	uint64_t m_blockedNs = 0;
+};
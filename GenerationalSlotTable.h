@@ -0,0 +1,193 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <json11/json11.hpp>
+
+// Pending callbacks by handle, O(1) pop and O(log n) insert under one short lock
+// A handle is the slot index plus the slot's generation, so a late or repeated pop of a reused slot finds nothing instead of someone else's entry
+// Each entry has its own timeout, sweep hands back whatever outlived it
+template<typename T> class GenerationalSlotTable
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr int kIndexBits = 16;
+	static constexpr size_t kMaxSlots = size_t(1) << kIndexBits;
+
+	// Positive, fits the int32 callback ids on the wire. 0 when every slot is taken
+	int32_t insert(T value, const std::chrono::milliseconds timeout)
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+
+		uint32_t index = 0;
+
+		if (!m_free.empty())
+		{
+			index = m_free.back();
+			m_free.pop_back();
+		}
+		else if (m_slots.size() < kMaxSlots)
+		{
+			index = uint32_t(m_slots.size());
+			m_slots.emplace_back();
+		}
+		else
+		{
+			++m_rejected;
+			return 0;
+		}
+
+		Slot &slot = m_slots[index];
+		slot.used = true;
+		slot.value = std::move(value);
+		slot.deadline = Clock::now() + timeout;
+
+		const int32_t handle = makeHandle(index, slot.generation);
+		m_deadlines.push({slot.deadline, handle});
+
+		if (++m_pending > m_peakPending)
+			m_peakPending = m_pending;
+
+		return handle;
+	}
+
+	// False for a handle that was never issued, already popped or swept
+	bool pop(const int32_t handle, T &out_value)
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+
+		Slot *slot = find(handle);
+
+		if (slot == nullptr)
+			return false;
+
+		out_value = std::move(slot->value);
+		release(handle);
+		return true;
+	}
+
+	// Every entry pred matches, e.g. everything belonging to a browser that's closing
+	template<typename Pred> std::vector<std::pair<int32_t, T>> removeIf(Pred pred)
+	{
+		std::vector<std::pair<int32_t, T>> result;
+		std::lock_guard<std::mutex> grd(m_mtx);
+
+		for (uint32_t index = 0; index < m_slots.size(); ++index)
+		{
+			Slot &slot = m_slots[index];
+
+			if (!slot.used || !pred(slot.value))
+				continue;
+
+			const int32_t handle = makeHandle(index, slot.generation);
+			result.push_back({handle, std::move(slot.value)});
+			release(handle);
+		}
+
+		return result;
+	}
+
+	// Entries past their deadline, earliest first
+	std::vector<std::pair<int32_t, T>> sweep()
+	{
+		std::vector<std::pair<int32_t, T>> result;
+		std::lock_guard<std::mutex> grd(m_mtx);
+
+		const Clock::time_point now = Clock::now();
+
+		// Earliest deadline on top, only the expired ones are ever looked at
+		while (!m_deadlines.empty() && m_deadlines.top().first <= now)
+		{
+			const int32_t handle = m_deadlines.top().second;
+			m_deadlines.pop();
+
+			// The generation can wrap while a busy slot is reused, its own deadline says whether this is really the entry that expired
+			Slot *slot = find(handle);
+
+			if (slot != nullptr && slot->deadline <= now)
+			{
+				result.push_back({handle, std::move(slot->value)});
+				release(handle);
+				++m_expired;
+			}
+		}
+
+		return result;
+	}
+
+	size_t pending() const
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+		return m_pending;
+	}
+
+	// { "pending": 0, "peak_pending": 0, "expired": 0, "rejected": 0 }
+	json11::Json stats() const
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+		return json11::Json::object{{"pending", double(m_pending)}, {"peak_pending", double(m_peakPending)}, {"expired", double(m_expired)}, {"rejected", double(m_rejected)}};
+	}
+
+private:
+	struct Slot
+	{
+		// Starts at 1 so no handle is ever 0
+		uint16_t generation = 1;
+		bool used = false;
+		T value{};
+		Clock::time_point deadline;
+	};
+
+	static int32_t makeHandle(const uint32_t index, const uint16_t generation) { return int32_t((uint32_t(generation) << kIndexBits) | index); }
+
+	// These need m_mtx held
+	Slot *find(const int32_t handle)
+	{
+		const uint32_t index = uint32_t(handle) & (kMaxSlots - 1);
+
+		if (handle <= 0 || index >= m_slots.size())
+			return nullptr;
+
+		Slot &slot = m_slots[index];
+
+		if (!slot.used || makeHandle(index, slot.generation) != handle)
+			return nullptr;
+
+		return &slot;
+	}
+
+	void release(const int32_t handle)
+	{
+		const uint32_t index = uint32_t(handle) & (kMaxSlots - 1);
+		Slot &slot = m_slots[index];
+
+		slot.used = false;
+		slot.value = T{};
+
+		// 15 bits keep the handle positive, wrapping skips 0
+		slot.generation = uint16_t(slot.generation % 0x7FFF + 1);
+
+		m_free.push_back(index);
+		--m_pending;
+	}
+
+	mutable std::mutex m_mtx;
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_free;
+
+	// Deadline and handle, stale handles in here are skipped when they come up
+	using Deadline = std::pair<Clock::time_point, int32_t>;
+	std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> m_deadlines;
+
+	size_t m_pending = 0;
+	size_t m_peakPending = 0;
+	uint64_t m_expired = 0;
+	uint64_t m_rejected = 0;
+};
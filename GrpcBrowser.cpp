@@ -1,9 +1,30 @@
 #include "GrpcBrowser.h"
+#include "IpcBackoff.h"
+#include "IpcEndpoint.h"
 #include "SlBrowser.h"
 #include "WindowsFunctions.h"
 
 #include <filesystem>
 
+using namespace json11;
+
+namespace {
+
+uint64_t nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Converts straight from the bytes to the UTF-16 a CefListValue holds, no std::string in between
+void setUtf8String(CefRefPtr<CefListValue> list, const size_t index, const char *data, const size_t length)
+{
+	CefString value;
+	cef_string_utf8_to_utf16(data, length, value.GetWritableStruct());
+	list->SetString(index, value);
+}
+
+}
+
 /***
 * Server
 * Receiving messages from the plugin
@@ -13,42 +34,141 @@ class grpc_proxy_objImpl final : public grpc_proxy_obj::Service
 {
 	grpc::Status com_grpc_js_executeCallback(grpc::ServerContext *context, const grpc_js_api_ExecuteCallback *request, grpc_js_api_Reply *response) override
 	{
+		executeCallback(*request);
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_run_javascriptOnBrowser(grpc::ServerContext *context, const grpc_run_javascriptOnBrowser *request, grpc_empty_Reply *response) override
+	{
+		runJavascriptOnBrowser(*request);
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_window_toggleVisibility(grpc::ServerContext *context, const grpc_window_toggleVisibility *request, grpc_empty_Reply *response) override
+	{
+		toggleVisibility();
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_stream(grpc::ServerContext *context, grpc::ServerReaderWriter<grpc_stream_Message, grpc_stream_Message> *stream) override
+	{
+		grpc_stream_Message message;
+		uint64_t expectedSeq = 1;
+
+		while (stream->Read(&message))
+		{
+			if (message.seq() != expectedSeq)
+				printf("com_grpc_stream expected seq %llu, got %llu\n", (unsigned long long)expectedSeq, (unsigned long long)message.seq());
+
+			expectedSeq = message.seq() + 1;
+
+			switch (message.payload_case())
+			{
+			case grpc_stream_Message::kExecuteCallback:
+				executeCallback(message.execute_callback());
+				break;
+			case grpc_stream_Message::kRunJavascript:
+				runJavascriptOnBrowser(message.run_javascript());
+				break;
+			case grpc_stream_Message::kToggleVisibility:
+				toggleVisibility();
+				break;
+			default:
+				break;
+			}
+		}
+
+		return grpc::Status::OK;
+	}
+
+private:
+	void executeCallback(const grpc_js_api_ExecuteCallback &request)
+	{
+		GrpcBrowser::instance().getClient()->acknowledge(request.funcid());
+
+		// Expired or its browser closed, the plugin's answer has nobody to go to
+		int rendererCallbackId = 0;
+		CefRefPtr<CefBrowser> browser = SlBrowser::instance().browserClient->PopCallback(request.funcid(), rendererCallbackId);
+
+		if (browser == nullptr)
+		{
+			// Still has to be released
+			if (request.has_payload())
+				GrpcBrowser::instance().getPayloadRing().read(request.payload().position(), request.payload().length(), [](const char *, const size_t) {});
+
+			printf("com_grpc_js_executeCallback failed to find browser for function\n");
+			return;
+		}
+
 		CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("executeCallback");
 		CefRefPtr<CefListValue> execute_args = msg->GetArgumentList();
-		execute_args->SetInt(0, request->funcid());
-		execute_args->SetString(1, request->jsonstr());
+		execute_args->SetInt(0, rendererCallbackId);
 
-		if (auto ptr = SlBrowser::instance().browserClient->PopCallback(request->funcid()))
+		if (request.has_payload())
+		{
+			auto fromRing = [&execute_args](const char *data, const size_t length) { setUtf8String(execute_args, 1, data, length); };
+
+			if (!GrpcBrowser::instance().getPayloadRing().read(request.payload().position(), request.payload().length(), fromRing))
+			{
+				// Lost on the way, not an answer from the plugin
+				execute_args->SetString(1, "{\"error\":\"Failed to read result from shared memory\"}");
+				execute_args->SetBool(2, true);
+			}
+		}
+		else if (!request.jsonstr_zlib().empty())
 		{
-			SendBrowserProcessMessage(ptr, PID_RENDERER, msg);
+			std::string jsonStr;
+
+			if (GrpcBrowser::instance().getCompression().decompress(request.jsonstr_zlib(), request.original_length(), jsonStr))
+				execute_args->SetString(1, jsonStr);
+			else
+			{
+				execute_args->SetString(1, "{\"error\":\"Failed to decompress result\"}");
+				execute_args->SetBool(2, true);
+			}
 		}
 		else
 		{
-			printf("com_grpc_js_executeCallback failed to find browser for function");
+			execute_args->SetString(1, request.jsonstr());
 		}
 
-		return grpc::Status::OK;
+		SendBrowserProcessMessage(browser, PID_RENDERER, msg);
 	}
 
-	grpc::Status com_grpc_run_javascriptOnBrowser(grpc::ServerContext *context, const grpc_run_javascriptOnBrowser *request, grpc_empty_Reply *response) override
+	void runJavascriptOnBrowser(const grpc_run_javascriptOnBrowser &request)
 	{
-		CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("executeJavascript");
-		CefRefPtr<CefListValue> execute_args = msg->GetArgumentList();
-		execute_args->SetString(0, request->str());
+		const CefString code = request.str();
+
+		// Sending hands the message over, every browser gets its own
+		auto send = [&code](CefRefPtr<CefBrowser> browser) {
+			CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("executeJavascript");
+			CefRefPtr<CefListValue> execute_args = msg->GetArgumentList();
+			execute_args->SetString(0, code);
 
-		if (auto ptr = SlBrowser::instance().browserClient->GetMostRecentRenderKnown())
+			SendBrowserProcessMessage(browser, PID_RENDERER, msg);
+		};
+
+		// No target given, e.g. script registered before requests carried the browser's id
+		if (request.browser_ids_size() == 0)
 		{
-			SendBrowserProcessMessage(ptr, PID_RENDERER, msg);
+			if (auto ptr = SlBrowser::instance().browserClient->GetMostRecentRenderKnown())
+				send(ptr);
+			else
+				printf("com_grpc_run_javascriptOnBrowser failed to a suitable browser for function");
+
+			return;
 		}
-		else
+
+		for (const int browserId : request.browser_ids())
 		{
-			printf("com_grpc_run_javascriptOnBrowser failed to a suitable browser for function");
+			if (auto browser = SlBrowser::instance().browserClient->GetBrowser(browserId))
+				send(browser);
+			else
+				printf("com_grpc_run_javascriptOnBrowser browser %d is closed\n", browserId);
 		}
-
-		return grpc::Status::OK;
 	}
 
-	grpc::Status com_grpc_window_toggleVisibility(grpc::ServerContext *context, const grpc_window_toggleVisibility *request, grpc_empty_Reply *response) override
+	void toggleVisibility()
 	{
 		// If hidden
 		if (SlBrowser::instance().m_widget->isHidden())
@@ -77,7 +197,6 @@ class grpc_proxy_objImpl final : public grpc_proxy_obj::Service
 		}
 
 		SlBrowser::instance().saveHiddenState(SlBrowser::instance().m_widget->isHidden());
-		return grpc::Status::OK;
 	}
 };
 
@@ -86,23 +205,427 @@ class grpc_proxy_objImpl final : public grpc_proxy_obj::Service
 * Sending messages to the plugin
 */
 
-grpc_proxy_objClient::grpc_proxy_objClient(std::shared_ptr<grpc::Channel> channel) : stub_(grpc_plugin_obj::NewStub(channel))
+grpc_proxy_objClient::grpc_proxy_objClient(std::shared_ptr<grpc::Channel> channel) : m_channel(channel), stub_(grpc_plugin_obj::NewStub(channel))
 {
 	m_connected = channel->WaitForConnected(std::chrono::system_clock::now() + std::chrono::seconds(3));
+
+	// Starts at the clock so a restarted browser never reuses a key the plugin still remembers
+	m_nextRequestKey = uint64_t(std::chrono::system_clock::now().time_since_epoch().count());
+
+	if (!m_connected)
+		m_downSince = nowNs();
+
+	m_reconnectThread = std::thread(&grpc_proxy_objClient::reconnectThread, this);
+	m_eventsThread = std::thread(&grpc_proxy_objClient::eventsThread, this);
+}
+
+grpc_proxy_objClient::~grpc_proxy_objClient()
+{
+	{
+		std::lock_guard<std::mutex> grd(m_replayMtx);
+		m_stopping = true;
+	}
+
+	m_reconnectCv.notify_all();
+
+	{
+		std::lock_guard<std::mutex> grd(m_eventsMtx);
+
+		if (m_eventsContext != nullptr)
+			m_eventsContext->TryCancel();
+	}
+
+	m_eventsCv.notify_all();
+
+	if (m_reconnectThread.joinable())
+		m_reconnectThread.join();
+
+	if (m_eventsThread.joinable())
+		m_eventsThread.join();
+
+	closeStream();
+}
+
+bool grpc_proxy_objClient::openStream()
+{
+	std::lock_guard<std::mutex> grd(m_streamMtx);
+	return openStreamLocked();
+}
+
+bool grpc_proxy_objClient::openStreamLocked()
+{
+	if (m_stream != nullptr)
+		return true;
+
+	m_streamContext = std::make_unique<grpc::ClientContext>();
+	m_stream = stub_->com_grpc_stream(m_streamContext.get());
+	m_streamSeq = 0;
+
+	if (m_stream == nullptr)
+		return false;
+
+	// Lets the plugin compress what it sends back to us
+	grpc_stream_Message message;
+	message.mutable_hello()->add_accept_encoding(IpcCompression::kEncoding);
+	message.set_seq(++m_streamSeq);
+
+	if (writeLocked(message))
+		return true;
+
+	resetStreamLocked();
+	return false;
 }
 
-bool grpc_proxy_objClient::send_js_api(const std::string &funcName, const std::string &params)
+bool grpc_proxy_objClient::writeLocked(grpc_stream_Message &message)
 {
-	grpc_js_api_Request request;
-	request.set_funcname(funcName);
-	request.set_params(params);
+	// Runs on the CEF UI thread, a plugin that stopped reading costs kRpcDeadline at most
+	m_writeWatchdog.arm(m_streamContext.get(), kRpcDeadline);
+	const bool written = m_stream->Write(message);
+	m_writeWatchdog.disarm();
+
+	return written;
+}
+
+void grpc_proxy_objClient::resetStreamLocked()
+{
+	m_streamContext->TryCancel();
+	m_stream->Finish();
+	m_stream.reset();
+	m_streamContext.reset();
+}
+
+void grpc_proxy_objClient::closeStream()
+{
+	std::lock_guard<std::mutex> grd(m_streamMtx);
+
+	if (m_stream == nullptr)
+		return;
+
+	m_stream->WritesDone();
+	m_stream->Finish();
+	m_stream.reset();
+	m_streamContext.reset();
+}
+
+bool grpc_proxy_objClient::writeStream(grpc_stream_Message &message)
+{
+	std::lock_guard<std::mutex> grd(m_streamMtx);
+
+	const auto now = std::chrono::steady_clock::now();
+
+	if (m_stream == nullptr && !m_stopping && now >= m_streamRetryAt)
+	{
+		if (openStreamLocked())
+			++m_streamReopens;
+		else
+			m_streamRetryAt = now + m_streamBackoff.next();
+	}
+
+	if (m_stream == nullptr)
+	{
+		++m_streamFallbacks;
+		return false;
+	}
+
+	message.set_seq(++m_streamSeq);
+
+	if (writeLocked(message))
+	{
+		m_streamBackoff.reset();
+		return true;
+	}
+
+	// Broken, unary until the backoff lets the next write try a new stream
+	printf("grpc_proxy_objClient::writeStream failed, falling back to unary calls\n");
+	resetStreamLocked();
+	++m_streamResets;
+	m_streamRetryAt = now + m_streamBackoff.next();
+	++m_streamFallbacks;
+	return false;
+}
+
+bool grpc_proxy_objClient::send_js_api(grpc_js_api_Request request)
+{
+	grpc_stream_Message message;
+
+	{
+		std::lock_guard<std::mutex> grd(m_replayMtx);
+
+		if (!storeUnacked(std::move(request), message))
+			return false;
+	}
+
+	// Sent from a copy outside the lock, so a stalled plugin holds up this thread for kRpcDeadline at most and nothing else
+	if (message.has_js_api() && !sendRequest(message))
+	{
+		std::lock_guard<std::mutex> grd(m_replayMtx);
+		onDisconnected();
+	}
+
+	return true;
+}
+
+bool grpc_proxy_objClient::storeUnacked(grpc_js_api_Request request, grpc_stream_Message &out_message)
+{
+	// A callback id is only reused once its earlier request is done with
+	forgetUnacked(request.callbackid());
+
+	request.set_request_key(m_nextRequestKey + 1);
+	const size_t bytes = request.ByteSizeLong();
+
+	if (m_unacked.size() >= kMaxUnacked || m_unackedBytes + bytes > kMaxUnackedBytes)
+	{
+		++m_rejected;
+		return false;
+	}
+
+	const uint64_t key = ++m_nextRequestKey;
+	m_unackedKeys[request.callbackid()] = key;
+	m_unackedBytes += bytes;
+
+	// Swapped in, not copied
+	grpc_stream_Message &stored = m_unacked[key];
+	*stored.mutable_js_api() = std::move(request);
+
+	// Held until the reconnect, it replays everything in order
+	if (!m_connected)
+	{
+		++m_queuedWhileDown;
+		return true;
+	}
+
+	out_message = stored;
+	return true;
+}
+
+bool grpc_proxy_objClient::sendRequest(grpc_stream_Message &message)
+{
+	const uint64_t resets = m_streamResets;
+	const bool streamed = writeStream(message);
+
+	// Earlier writes the stream accepted may never have reached the plugin, the reconnect thread replays everything still unacknowledged
+	if (m_streamResets != resets)
+	{
+		std::lock_guard<std::mutex> grd(m_replayMtx);
+		onDisconnected();
+	}
+
+	if (streamed)
+		return true;
 
 	grpc_js_api_Reply reply;
 	grpc::ClientContext context;
-	grpc::Status status = stub_->com_grpc_js_api(&context, request, &reply);
+	context.set_deadline(std::chrono::system_clock::now() + kRpcDeadline);
+	return stub_->com_grpc_js_api(&context, message.js_api(), &reply).ok();
+}
+
+void grpc_proxy_objClient::acknowledge(const int callbackId)
+{
+	std::lock_guard<std::mutex> grd(m_replayMtx);
+	forgetUnacked(callbackId);
+}
+
+void grpc_proxy_objClient::forgetUnacked(const int callbackId)
+{
+	auto itr = m_unackedKeys.find(callbackId);
+
+	if (itr == m_unackedKeys.end())
+		return;
+
+	auto request = m_unacked.find(itr->second);
+
+	if (request != m_unacked.end())
+	{
+		m_unackedBytes -= request->second.js_api().ByteSizeLong();
+		m_unacked.erase(request);
+	}
+
+	m_unackedKeys.erase(itr);
+}
+
+void grpc_proxy_objClient::onDisconnected()
+{
+	if (!m_connected)
+		return;
+
+	printf("grpc_proxy_objClient lost the plugin, reconnecting\n");
+
+	m_connected = false;
+	m_downSince = nowNs();
+	++m_disconnects;
+	m_reconnectCv.notify_all();
+}
+
+bool grpc_proxy_objClient::replayUnacked(std::unique_lock<std::mutex> &lock)
+{
+	uint64_t lastKey = 0;
+	const uint64_t resets = m_streamResets;
+
+	// Anything the plugin already ran is dropped there by its request key
+	// Keys are send order, whatever is queued or acknowledged while the lock is released is picked up or skipped by the next lookup
+	while (true)
+	{
+		auto itr = m_unacked.upper_bound(lastKey);
+
+		if (itr == m_unacked.end())
+			return true;
+
+		lastKey = itr->first;
+		grpc_stream_Message message = itr->second;
+
+		lock.unlock();
+		const bool sent = sendRequest(message);
+		lock.lock();
+
+		// A stream that broke partway may have lost what was already replayed on it, start over
+		if (!sent || m_streamResets != resets)
+			return false;
+
+		++m_replayed;
+	}
+}
+
+void grpc_proxy_objClient::reconnectThread()
+{
+	std::unique_lock<std::mutex> lock(m_replayMtx);
+
+	while (true)
+	{
+		m_reconnectCv.wait(lock, [this] { return !m_connected || m_stopping; });
+
+		if (m_stopping)
+			return;
+
+		IpcBackoff backoff;
+		bool connected = false;
+
+		while (!connected && !m_stopping)
+		{
+			++m_reconnectAttempts;
+
+			// Waiting for the channel is the backoff, it returns as soon as the plugin is reachable again
+			lock.unlock();
+			connected = m_channel->WaitForConnected(std::chrono::system_clock::now() + backoff.next()) && openStream();
+			lock.lock();
+
+			// Still disconnected as far as send_js_api knows, so anything new is queued behind what's being replayed
+			if (connected && !replayUnacked(lock))
+				connected = false;
+		}
+
+		if (!connected)
+			return;
+
+		m_lastOutageNs = nowNs() - m_downSince;
+		m_totalOutageNs += m_lastOutageNs;
+		m_connected = true;
+
+		printf("grpc_proxy_objClient reconnected after %.1f ms, %zu requests replayed\n", double(m_lastOutageNs) / 1000000.0, m_unacked.size());
+	}
+}
+
+void grpc_proxy_objClient::eventsThread()
+{
+	IpcBackoff backoff;
+
+	while (true)
+	{
+		grpc::ClientContext context;
+
+		// Waits for the plugin to be reachable instead of failing straight away
+		context.set_wait_for_ready(true);
+
+		{
+			std::lock_guard<std::mutex> grd(m_eventsMtx);
+
+			if (m_stopping)
+				return;
+
+			m_eventsContext = &context;
+		}
+
+		grpc_events_Subscribe request;
+		std::unique_ptr<grpc::ClientReader<grpc_events_Event>> reader = stub_->com_grpc_events(&context, request);
+
+		grpc_events_Event event;
+		uint64_t lastSeq = 0;
+
+		while (reader->Read(&event))
+		{
+			backoff.reset();
+
+			if (lastSeq != 0 && event.seq() != lastSeq + 1)
+				printf("grpc_proxy_objClient::eventsThread %llu events dropped by the plugin\n", (unsigned long long)(event.seq() - lastSeq - 1));
+
+			lastSeq = event.seq();
+
+			if (auto client = SlBrowser::instance().browserClient)
+				client->DispatchObsEvent(event.name(), event.jsonstr());
+		}
+
+		reader->Finish();
+
+		std::unique_lock<std::mutex> lock(m_eventsMtx);
+		m_eventsContext = nullptr;
+
+		if (m_eventsCv.wait_for(lock, backoff.next(), [this] { return bool(m_stopping); }))
+			return;
+	}
+}
+
+Json grpc_proxy_objClient::health() const
+{
+	std::lock_guard<std::mutex> grd(m_replayMtx);
+
+	// An outage still going counts up to now
+	const uint64_t currentOutageNs = m_connected ? 0 : nowNs() - m_downSince;
+
+	return Json::object{{"connected", bool(m_connected)},
+			    {"disconnects", double(m_disconnects)},
+			    {"reconnect_attempts", double(m_reconnectAttempts)},
+			    {"replayed", double(m_replayed)},
+			    {"pending", double(m_unacked.size())},
+			    {"pending_bytes", double(m_unackedBytes)},
+			    {"queued_while_down", double(m_queuedWhileDown)},
+			    {"rejected", double(m_rejected)},
+			    {"last_outage_ms", double(m_connected ? m_lastOutageNs : currentOutageNs) / 1000000.0},
+			    {"total_outage_ms", double(m_totalOutageNs + currentOutageNs) / 1000000.0},
+			    {"stream_fallbacks", double(m_streamFallbacks)},
+			    {"stream_reopens", double(m_streamReopens)},
+			    {"stream_resets", double(m_streamResets)},
+			    {"write_timeouts", double(m_writeWatchdog.fired())}};
+}
+
+bool grpc_proxy_objClient::send_cancelRequests(const std::vector<int> &callbackIds)
+{
+	// Never replayed, even if this doesn't make it across
+	for (int callbackId : callbackIds)
+		acknowledge(callbackId);
+
+	grpc_stream_Message message;
+
+	for (int callbackId : callbackIds)
+		message.mutable_cancel_requests()->add_callbackids(callbackId);
+
+	if (writeStream(message))
+		return true;
+
+	grpc_js_api_CancelRequests request;
+
+	for (int callbackId : callbackIds)
+		request.add_callbackids(callbackId);
+
+	grpc_empty_Reply reply;
+	grpc::ClientContext context;
+	context.set_deadline(std::chrono::system_clock::now() + kRpcDeadline);
+	grpc::Status status = stub_->com_grpc_js_cancelRequests(&context, request, &reply);
 
 	if (!status.ok())
-		return m_connected = false;
+	{
+		std::lock_guard<std::mutex> grd(m_replayMtx);
+		onDisconnected();
+		return false;
+	}
 
 	return true;
 }
@@ -114,19 +637,20 @@ GrpcBrowser::GrpcBrowser() {}
 
 GrpcBrowser::~GrpcBrowser() {}
 
-bool GrpcBrowser::startServer(int32_t listenPort)
+bool GrpcBrowser::startServer(const std::string &address)
 {
 	// Don't repeat
-	if (m_listenPort != 0)
+	if (m_server != nullptr)
 		return false;
 
-	m_listenPort = listenPort;
+	m_listenAddress = address;
+	IpcEndpoint::removeSocketFile(m_listenAddress);
 
 	grpc::EnableDefaultHealthCheckService(true);
 	grpc::reflection::InitProtoReflectionServerBuilderPlugin();
 
 	m_builder = std::make_unique<grpc::ServerBuilder>();
-	m_builder->AddListeningPort(std::string("localhost:") + std::to_string(m_listenPort), grpc::InsecureServerCredentials());
+	m_builder->AddListeningPort(m_listenAddress, grpc::InsecureServerCredentials());
 
 	m_serverObj = std::make_unique<grpc_proxy_objImpl>();
 	m_builder->RegisterService(m_serverObj.get());
@@ -136,10 +660,20 @@ bool GrpcBrowser::startServer(int32_t listenPort)
 	return m_server != nullptr;
 }
 
-bool GrpcBrowser::connectToClient(int32_t portNumber)
+bool GrpcBrowser::connectToClient(const std::string &address)
 {
-	m_clientObj = std::make_unique<grpc_proxy_objClient>(grpc::CreateChannel("localhost:" + std::to_string(portNumber), grpc::InsecureChannelCredentials()));
+	m_clientObj = std::make_unique<grpc_proxy_objClient>(grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), IpcBackoff::channelArguments()));
+
+	// Unary calls still work if this fails
+	if (!m_clientObj->openStream())
+		printf("GrpcBrowser::connectToClient failed to open stream, using unary calls\n");
+
 	return m_clientObj != nullptr;
 }
 
+bool GrpcBrowser::openPayloadRing(int32_t ownerPid)
+{
+	return m_payloadRing.open(uint32_t(ownerPid));
+}
+
 void GrpcBrowser::stop() {}
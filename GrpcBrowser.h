@@ -1,8 +1,18 @@
 #pragma once
 
 #include "sl_browser_api.grpc.pb.h"
+#include "IpcPayload.h"
+#include "IpcCompression.h"
+#include "IpcBackoff.h"
+#include "IpcWriteWatchdog.h"
 
+#include <condition_variable>
 #include <filesystem>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
 
 #include <grpcpp/ext/proto_server_reflection_plugin.h>
 #include <grpcpp/grpcpp.h>
@@ -11,14 +21,99 @@
 class grpc_proxy_objClient
 {
 public:
+	// Requests kept for replay until the plugin answers them
+	static constexpr size_t kMaxUnacked = 1024;
+	static constexpr size_t kMaxUnackedBytes = 16 * 1024 * 1024;
+
+	// Unary calls and stream writes give up after this, a stalled plugin then counts as a disconnect rather than blocking the caller
+	static constexpr std::chrono::seconds kRpcDeadline{2};
+
 	grpc_proxy_objClient(std::shared_ptr<grpc::Channel> channel);
+	~grpc_proxy_objClient();
+
+	// Only false when too many requests are already waiting on the plugin, while disconnected it's queued and replayed on reconnect
+	bool send_js_api(grpc_js_api_Request request);
+	bool send_cancelRequests(const std::vector<int> &callbackIds);
+
+	// The plugin answered, it won't be replayed
+	void acknowledge(const int callbackId);
+
+	bool openStream();
+	void closeStream();
 
-	bool send_js_api(const std::string &funcName, const std::string &params);
+	// { "connected": true, "disconnects": 0, "reconnect_attempts": 0, "replayed": 0, "pending": 0, "pending_bytes": 0,
+	//   "queued_while_down": 0, "rejected": 0, "last_outage_ms": 0.0, "total_outage_ms": 0.0, "stream_fallbacks": 0, "stream_reopens": 0,
+	//   "stream_resets": 0, "write_timeouts": 0 }
+	json11::Json health() const;
 
 	std::atomic<bool> m_connected{false};
 
 private:
+	// False when there's no stream, the caller then falls back to the unary call
+	// A broken stream is reopened here once m_streamBackoff allows, so one failed write doesn't leave everything on unary
+	bool writeStream(grpc_stream_Message &message);
+
+	// These need m_streamMtx held
+	bool openStreamLocked();
+	void resetStreamLocked();
+	bool writeLocked(grpc_stream_Message &message);
+
+	// Stream, then unary. A stream that broke meanwhile may have dropped what it had buffered, every unacknowledged request is replayed
+	bool sendRequest(grpc_stream_Message &message);
+
+	// Needs m_replayMtx held. Keeps the request for replay, out_message is left empty unless it should be sent now
+	bool storeUnacked(grpc_js_api_Request request, grpc_stream_Message &out_message);
+
+	// These need m_replayMtx held
+	void forgetUnacked(const int callbackId);
+	void onDisconnected();
+
+	// Called and returns with lock held, but lets go of it around every send
+	bool replayUnacked(std::unique_lock<std::mutex> &lock);
+
+	void reconnectThread();
+
+	// Keeps the plugin's com_grpc_events stream open, resubscribing with backoff whenever it ends
+	void eventsThread();
+
+	std::shared_ptr<grpc::Channel> m_channel;
 	std::unique_ptr<grpc_plugin_obj::Stub> stub_;
+
+	mutable std::mutex m_replayMtx;
+	std::condition_variable m_reconnectCv;
+	std::thread m_reconnectThread;
+	std::atomic<bool> m_stopping{false};
+
+	std::mutex m_eventsMtx;
+	std::condition_variable m_eventsCv;
+	std::thread m_eventsThread;
+	grpc::ClientContext *m_eventsContext = nullptr;
+
+	// By request key, which is also send order. Kept already wrapped, a replay writes them as they are
+	std::map<uint64_t, grpc_stream_Message> m_unacked;
+	std::unordered_map<int, uint64_t> m_unackedKeys;
+	size_t m_unackedBytes = 0;
+	uint64_t m_nextRequestKey = 0;
+
+	uint64_t m_downSince = 0;
+	uint64_t m_disconnects = 0;
+	uint64_t m_reconnectAttempts = 0;
+	uint64_t m_replayed = 0;
+	uint64_t m_queuedWhileDown = 0;
+	uint64_t m_rejected = 0;
+	uint64_t m_lastOutageNs = 0;
+	uint64_t m_totalOutageNs = 0;
+
+	std::mutex m_streamMtx;
+	uint64_t m_streamSeq = 0;
+	std::unique_ptr<grpc::ClientContext> m_streamContext;
+	std::unique_ptr<grpc::ClientReaderWriter<grpc_stream_Message, grpc_stream_Message>> m_stream;
+	IpcBackoff m_streamBackoff;
+	std::chrono::steady_clock::time_point m_streamRetryAt;
+	std::atomic<uint64_t> m_streamFallbacks{0};
+	std::atomic<uint64_t> m_streamReopens{0};
+	std::atomic<uint64_t> m_streamResets{0};
+	IpcWriteWatchdog m_writeWatchdog;
 };
 
 class GrpcBrowser
@@ -30,22 +125,29 @@ public:
 		return a;
 	}
 
-	bool connectToClient(int32_t port);
-	bool startServer(int32_t port);
+	// "localhost:<port>" or "unix:<path>", see IpcEndpoint
+	bool connectToClient(const std::string &address);
+	bool startServer(const std::string &address);
+	bool openPayloadRing(int32_t ownerPid);
 
 	void stop();
 
 	auto *getClient() { return m_clientObj.get(); }
+	auto &getPayloadRing() { return m_payloadRing; }
+	auto &getCompression() { return m_compression; }
 
 private:
 	GrpcBrowser();
 	~GrpcBrowser();
 
-	int32_t m_listenPort{0};
+	std::string m_listenAddress;
 
 	std::wstring m_modulePath;
 	std::unique_ptr<grpc::Server> m_server;
 	std::unique_ptr<grpc::ServerBuilder> m_builder;
 	std::unique_ptr<grpc_proxy_obj::Service> m_serverObj;
 	std::unique_ptr<grpc_proxy_objClient> m_clientObj;
+
+	IpcPayloadRing m_payloadRing;
+	IpcCompression m_compression;
 };
@@ -1,9 +1,18 @@
 #include "GrpcPlugin.h"
+#include "IpcBackoff.h"
+#include "IpcEndpoint.h"
 #include "JavascriptApi.h"
+#include "ObsEventStream.h"
 #include "PluginJsHandler.h"
 
+#include <obs.h>
+#include <Windows.h>
+
+#include <algorithm>
 #include <filesystem>
 
+using namespace json11;
+
 /***
 * Server
 * Receiving messages from the browser
@@ -13,9 +22,134 @@ class grpc_plugin_objImpl final : public grpc_plugin_obj::Service
 {
 	grpc::Status com_grpc_js_api(grpc::ServerContext *context, const grpc_js_api_Request *request, grpc_js_api_Reply *response) override
 	{
-		PluginJsHandler::instance().pushApiRequest(request->funcname(), request->params());
+		// Only the fallback, it pays for the copy the stream avoids
+		grpc_js_api_Request copy(*request);
+		pushApiRequest(copy);
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_js_cancelRequests(grpc::ServerContext *context, const grpc_js_api_CancelRequests *request, grpc_empty_Reply *response) override
+	{
+		PluginJsHandler::instance().cancelApiRequests({request->callbackids().begin(), request->callbackids().end()});
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_stream(grpc::ServerContext *context, grpc::ServerReaderWriter<grpc_stream_Message, grpc_stream_Message> *stream) override
+	{
+		grpc_stream_Message message;
+		uint64_t expectedSeq = 1;
+
+		while (stream->Read(&message))
+		{
+			if (message.seq() != expectedSeq)
+				blog(LOG_WARNING, "grpc_plugin_objImpl::com_grpc_stream expected seq %llu, got %llu", (unsigned long long)expectedSeq, (unsigned long long)message.seq());
+
+			expectedSeq = message.seq() + 1;
+
+			switch (message.payload_case())
+			{
+			case grpc_stream_Message::kJsApi:
+			{
+				pushApiRequest(*message.mutable_js_api());
+				break;
+			}
+			case grpc_stream_Message::kCancelRequests:
+			{
+				const auto &request = message.cancel_requests();
+				PluginJsHandler::instance().cancelApiRequests({request.callbackids().begin(), request.callbackids().end()});
+				break;
+			}
+			case grpc_stream_Message::kHello:
+			{
+				const auto &encodings = message.hello().accept_encoding();
+				GrpcPlugin::instance().setPeerAcceptsCompression(std::find(encodings.begin(), encodings.end(), IpcCompression::kEncoding) != encodings.end());
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_events(grpc::ServerContext *context, const grpc_events_Subscribe *request, grpc::ServerWriter<grpc_events_Event> *writer) override
+	{
+		ObsEventStream &events = ObsEventStream::instance();
+		const uint64_t subscription = events.subscribe();
+
+		ObsEventStream::Event event;
+
+		// Wakes up now and then to notice the browser going away, nothing else would end the wait
+		while (!context->IsCancelled())
+		{
+			const ObsEventStream::WaitResult result = events.next(subscription, event, std::chrono::milliseconds(250));
+
+			if (result == ObsEventStream::WAIT_CLOSED)
+				break;
+
+			if (result == ObsEventStream::WAIT_TIMEOUT)
+				continue;
+
+			grpc_events_Event message;
+			message.set_seq(event.seq);
+			message.set_name(std::move(event.name));
+			message.set_jsonstr(std::move(event.jsonStr));
+
+			if (!writer->Write(message))
+				break;
+		}
+
 		return grpc::Status::OK;
 	}
+
+private:
+	// Moves the strings out, the request isn't used again
+	void pushApiRequest(grpc_js_api_Request &request)
+	{
+		auto client = GrpcPlugin::instance().getClient();
+
+		// A replay after the browser reconnected, or a unary retry of something the stream did deliver
+		// Already ran, but if its result was given up on while the browser was away that goes out again
+		if (!GrpcPlugin::instance().acceptRequestKey(request.request_key()))
+		{
+			if (client != nullptr)
+				client->resendGivenUp(request.callbackid());
+
+			return;
+		}
+
+		if (client != nullptr)
+			client->forgetGivenUp(request.callbackid());
+
+		std::unique_ptr<PluginJsHandler::TypedArgs> typedArgs;
+
+		switch (request.args_case())
+		{
+		case grpc_js_api_Request::kSceneitemTransform:
+		{
+			auto &transform = *request.mutable_sceneitem_transform();
+			typedArgs = std::make_unique<PluginJsHandler::TypedArgs>();
+			typedArgs->scene_name = std::move(*transform.mutable_scene());
+			typedArgs->source_name = std::move(*transform.mutable_item());
+			typedArgs->pos = {transform.pos().x(), transform.pos().y()};
+			typedArgs->scale = {transform.scale().x(), transform.scale().y()};
+			typedArgs->rotation = transform.rot();
+			typedArgs->crop = {transform.crop().left(), transform.crop().top(), transform.crop().right(), transform.crop().bottom()};
+			break;
+		}
+		case grpc_js_api_Request::kNoArgs:
+			typedArgs = std::make_unique<PluginJsHandler::TypedArgs>();
+			break;
+		default:
+			break;
+		}
+
+		// mutable_params would switch the oneof over to params, only take it when that's what was sent
+		std::string params = request.args_case() == grpc_js_api_Request::kParams ? std::move(*request.mutable_params()) : std::string();
+
+		PluginJsHandler::instance().pushApiRequest(std::move(*request.mutable_funcname()), std::move(params), request.callbackid(), request.priority(), request.browser_id(), std::move(typedArgs));
+	}
 };
 
 /***
@@ -23,35 +157,283 @@ class grpc_plugin_objImpl final : public grpc_plugin_obj::Service
 * Sending messages to the browser
 */
 
-grpc_plugin_objClient::grpc_plugin_objClient(std::shared_ptr<grpc::Channel> channel) : stub_(grpc_proxy_obj::NewStub(channel))
+grpc_plugin_objClient::grpc_plugin_objClient(std::shared_ptr<grpc::Channel> channel) : m_channel(channel), stub_(grpc_proxy_obj::NewStub(channel))
 {
 	m_connected = channel->WaitForConnected(std::chrono::system_clock::now() + std::chrono::seconds(3));
+	m_outbox.start([this](const int functionId, std::string jsonStr) { return deliverCallback(functionId, std::move(jsonStr)); });
+}
+
+void grpc_plugin_objClient::shutdown()
+{
+	// Whatever is left goes out once, nobody waits on a browser that's gone
+	m_stopping = true;
+	m_outbox.stop();
+	closeStream();
+}
+
+bool grpc_plugin_objClient::openStream()
+{
+	std::lock_guard<std::mutex> grd(m_streamMtx);
+	return openStreamLocked();
+}
+
+bool grpc_plugin_objClient::openStreamLocked()
+{
+	if (m_stream != nullptr)
+		return true;
+
+	m_streamContext = std::make_unique<grpc::ClientContext>();
+	m_stream = stub_->com_grpc_stream(m_streamContext.get());
+	m_streamSeq = 0;
+
+	return m_stream != nullptr;
+}
+
+void grpc_plugin_objClient::resetStreamLocked()
+{
+	m_streamContext->TryCancel();
+	m_stream->Finish();
+	m_stream.reset();
+	m_streamContext.reset();
+}
+
+void grpc_plugin_objClient::closeStream()
+{
+	std::lock_guard<std::mutex> grd(m_streamMtx);
+
+	if (m_stream == nullptr)
+		return;
+
+	m_stream->WritesDone();
+	m_stream->Finish();
+	m_stream.reset();
+	m_streamContext.reset();
+}
+
+bool grpc_plugin_objClient::writeStream(grpc_stream_Message &message)
+{
+	std::lock_guard<std::mutex> grd(m_streamMtx);
+
+	const auto now = std::chrono::steady_clock::now();
+
+	if (m_stream == nullptr && !m_stopping && now >= m_streamRetryAt)
+	{
+		if (openStreamLocked())
+			++m_streamReopens;
+		else
+			m_streamRetryAt = now + m_streamBackoff.next();
+	}
+
+	if (m_stream == nullptr)
+	{
+		++m_streamFallbacks;
+		return false;
+	}
+
+	message.set_seq(++m_streamSeq);
+
+	if (writeLocked(message))
+	{
+		m_streamBackoff.reset();
+		return true;
+	}
+
+	// Broken, unary until the backoff lets the next write try a new stream
+	blog(LOG_WARNING, "grpc_plugin_objClient::writeStream failed, falling back to unary calls");
+	resetStreamLocked();
+	m_streamRetryAt = now + m_streamBackoff.next();
+	++m_streamFallbacks;
+	return false;
 }
 
-bool grpc_plugin_objClient::send_executeCallback(const int functionId, const std::string &jsonStr)
+void grpc_plugin_objClient::send_executeCallback(const int functionId, std::string jsonStr)
 {
-	grpc_js_api_ExecuteCallback request;
-	request.set_funcid(functionId);
-	request.set_jsonstr(jsonStr.c_str());
+	m_outbox.push(functionId, std::move(jsonStr));
+}
+
+bool grpc_plugin_objClient::writeLocked(grpc_stream_Message &message)
+{
+	m_writeWatchdog.arm(m_streamContext.get(), kRpcDeadline);
+	const bool written = m_stream->Write(message);
+	m_writeWatchdog.disarm();
+
+	return written;
+}
+
+bool grpc_plugin_objClient::deliverCallback(const int functionId, std::string jsonStr)
+{
+	// The message, its parts and their string headers all come out of one block on this thread's stack
+	alignas(8) char arenaBlock[kArenaBlockSize];
+	google::protobuf::ArenaOptions arenaOptions;
+	arenaOptions.initial_block = arenaBlock;
+	arenaOptions.initial_block_size = sizeof(arenaBlock);
+	google::protobuf::Arena arena(arenaOptions);
+
+	grpc_stream_Message *message = google::protobuf::Arena::CreateMessage<grpc_stream_Message>(&arena);
+	grpc_js_api_ExecuteCallback *request = message->mutable_execute_callback();
+	request->set_funcid(functionId);
+
+	IpcPayloadRing &ring = GrpcPlugin::instance().getPayloadRing();
+	uint64_t position = 0;
+	bool inRing = false;
+
+	// Large results are copied once into shared memory, only the reference goes over grpc
+	if (jsonStr.size() >= IpcPayloadRing::kInlineThreshold && jsonStr.size() <= UINT32_MAX && ring.readerAttached())
+		inRing = ring.write(jsonStr.data(), jsonStr.size(), position);
+
+	IpcCompression &compression = GrpcPlugin::instance().getCompression();
+	std::string compressed;
+
+	if (inRing)
+	{
+		request->mutable_payload()->set_position(position);
+		request->mutable_payload()->set_length(uint32_t(jsonStr.size()));
+	}
+	else if (compression.shouldCompress(jsonStr.size()) && jsonStr.size() <= UINT32_MAX && GrpcPlugin::instance().peerAcceptsCompression() &&
+		 compression.compress(jsonStr, compressed))
+	{
+		request->set_jsonstr_zlib(std::move(compressed));
+		request->set_original_length(uint32_t(jsonStr.size()));
+	}
+	else
+	{
+		// Takes the outbox's buffer as is, embedded NULs included
+		request->set_jsonstr(std::move(jsonStr));
+	}
+
+	// Runs on the outbox's thread, so waiting out a short outage here holds up nothing but later callbacks
+	IpcBackoff backoff;
+	const auto deadline = std::chrono::steady_clock::now() + kRetryBudget;
+
+	while (!sendCallback(*message))
+	{
+		if (m_stopping || std::chrono::steady_clock::now() >= deadline)
+		{
+			// Nobody will read it, don't let it hold up the ring
+			if (inRing)
+				ring.release(position);
+
+			// The browser replays the request once it's back, the result goes out again then rather than running it twice
+			if (!m_stopping)
+				keepGivenUp(functionId, request->jsonstr().empty() ? std::move(jsonStr) : std::move(*request->mutable_jsonstr()));
+
+			++m_givenUp;
+			m_connected = false;
+			return false;
+		}
+
+		++m_retries;
+
+		if (m_channel->WaitForConnected(std::chrono::system_clock::now() + backoff.next()) && openStream())
+			++m_reconnects;
+	}
+
+	m_connected = true;
+	return true;
+}
+
+bool grpc_plugin_objClient::sendCallback(grpc_stream_Message &message)
+{
+	if (writeStream(message))
+		return true;
 
 	grpc_js_api_Reply reply;
 	grpc::ClientContext context;
-	grpc::Status status = stub_->com_grpc_js_executeCallback(&context, request, &reply);
+	context.set_deadline(std::chrono::system_clock::now() + kRpcDeadline);
+	return stub_->com_grpc_js_executeCallback(&context, message.execute_callback(), &reply).ok();
+}
 
-	if (!status.ok())
-		return m_connected = false;
+void grpc_plugin_objClient::keepGivenUp(const int functionId, std::string jsonStr)
+{
+	if (jsonStr.size() > kMaxGivenUpBytes)
+		return;
 
-	return true;
+	std::lock_guard<std::mutex> grd(m_givenUpMtx);
+
+	auto itr = m_givenUpResults.find(functionId);
+
+	if (itr != m_givenUpResults.end())
+	{
+		m_givenUpBytes -= itr->second.size();
+		itr->second = std::move(jsonStr);
+		m_givenUpBytes += itr->second.size();
+		return;
+	}
+
+	m_givenUpBytes += jsonStr.size();
+	m_givenUpResults.emplace(functionId, std::move(jsonStr));
+	m_givenUpOrder.push_back(functionId);
+
+	// Ids in the order may already have been taken or forgotten
+	while (!m_givenUpOrder.empty() && (m_givenUpResults.size() > kMaxGivenUpResults || m_givenUpBytes > kMaxGivenUpBytes))
+	{
+		auto oldest = m_givenUpResults.find(m_givenUpOrder.front());
+		m_givenUpOrder.pop_front();
+
+		if (oldest == m_givenUpResults.end())
+			continue;
+
+		m_givenUpBytes -= oldest->second.size();
+		m_givenUpResults.erase(oldest);
+	}
+}
+
+void grpc_plugin_objClient::resendGivenUp(const int functionId)
+{
+	std::string jsonStr;
+
+	{
+		std::lock_guard<std::mutex> grd(m_givenUpMtx);
+
+		auto itr = m_givenUpResults.find(functionId);
+
+		if (itr == m_givenUpResults.end())
+			return;
+
+		m_givenUpBytes -= itr->second.size();
+		jsonStr = std::move(itr->second);
+		m_givenUpResults.erase(itr);
+	}
+
+	++m_resent;
+	send_executeCallback(functionId, std::move(jsonStr));
 }
 
-bool grpc_plugin_objClient::send_executeJavascript(const std::string& codeStr)
+void grpc_plugin_objClient::forgetGivenUp(const int functionId)
 {
-	grpc_run_javascriptOnBrowser request;
-	request.set_str(codeStr.c_str());
+	std::lock_guard<std::mutex> grd(m_givenUpMtx);
+
+	auto itr = m_givenUpResults.find(functionId);
+
+	if (itr == m_givenUpResults.end())
+		return;
+
+	m_givenUpBytes -= itr->second.size();
+	m_givenUpResults.erase(itr);
+}
+
+Json grpc_plugin_objClient::getConnectionStats() const
+{
+	return Json::object{{"connected", bool(m_connected)}, {"retries", double(m_retries)}, {"reconnects", double(m_reconnects)}, {"given_up", double(m_givenUp)}, {"resent", double(m_resent)},
+			    {"stream_fallbacks", double(m_streamFallbacks)}, {"stream_reopens", double(m_streamReopens)},
+			    {"write_timeouts", double(m_writeWatchdog.fired())}};
+}
+
+bool grpc_plugin_objClient::send_executeJavascript(std::string codeStr, const std::vector<int> &browserIds)
+{
+	grpc_stream_Message message;
+	message.mutable_run_javascript()->set_str(std::move(codeStr));
+
+	for (const int browserId : browserIds)
+		message.mutable_run_javascript()->add_browser_ids(browserId);
+
+	if (writeStream(message))
+		return true;
 
 	grpc_empty_Reply reply;
 	grpc::ClientContext context;
-	grpc::Status status = stub_->com_grpc_run_javascriptOnBrowser(&context, request, &reply);
+	context.set_deadline(std::chrono::system_clock::now() + kRpcDeadline);
+	grpc::Status status = stub_->com_grpc_run_javascriptOnBrowser(&context, message.run_javascript(), &reply);
 
 	if (!status.ok())
 		return m_connected = false;
@@ -61,10 +443,17 @@ bool grpc_plugin_objClient::send_executeJavascript(const std::string& codeStr)
 
 bool grpc_plugin_objClient::send_windowToggleVisibility()
 {
+	grpc_stream_Message message;
+	message.mutable_toggle_visibility();
+
+	if (writeStream(message))
+		return true;
+
 	grpc_window_toggleVisibility request;
 
 	grpc_empty_Reply reply;
 	grpc::ClientContext context;
+	context.set_deadline(std::chrono::system_clock::now() + kRpcDeadline);
 	grpc::Status status = stub_->com_grpc_window_toggleVisibility(&context, request, &reply);
 
 	if (!status.ok())
@@ -80,21 +469,27 @@ GrpcPlugin::GrpcPlugin() {}
 
 GrpcPlugin::~GrpcPlugin() {}
 
-bool GrpcPlugin::startServer(int32_t listenPort)
+bool GrpcPlugin::startServer(const std::string &address)
 {
 	// Don't repeat
-	if (m_listenPort != 0)
+	if (m_server != nullptr)
 		return false;
 
-	m_listenPort = listenPort;
+	m_listenAddress = address;
+	IpcEndpoint::removeSocketFile(m_listenAddress);
 
 	grpc::EnableDefaultHealthCheckService(true);
 	grpc::reflection::InitProtoReflectionServerBuilderPlugin();
 
 	m_builder = std::make_unique<grpc::ServerBuilder>();
-	m_builder->AddListeningPort(std::string("localhost:") + std::to_string(m_listenPort), grpc::InsecureServerCredentials());
+	m_builder->AddListeningPort(m_listenAddress, grpc::InsecureServerCredentials());
 
 	m_serverObj = std::make_unique<grpc_plugin_objImpl>();
+
+	// Has to exist before the browser starts, it maps it by our pid. Without it everything just goes inline
+	if (!m_payloadRing.create(uint32_t(GetCurrentProcessId())))
+		blog(LOG_WARNING, "GrpcPlugin::startServer failed to create payload ring, large results will go inline");
+
 	m_builder->RegisterService(m_serverObj.get());
 
 	m_server = m_builder->BuildAndStart();
@@ -102,22 +497,73 @@ bool GrpcPlugin::startServer(int32_t listenPort)
 	return m_server != nullptr;
 }
 
-bool GrpcPlugin::connectToClient(int32_t portNumber)
+bool GrpcPlugin::connectToClient(const std::string &address)
 {
-	m_clientObj = std::make_unique<grpc_plugin_objClient>(grpc::CreateChannel("localhost:" + std::to_string(portNumber), grpc::InsecureChannelCredentials()));
+	m_clientObj = std::make_unique<grpc_plugin_objClient>(grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), IpcBackoff::channelArguments()));
+
+	// Unary calls still work if this fails
+	if (!m_clientObj->openStream())
+		blog(LOG_WARNING, "GrpcPlugin::connectToClient failed to open stream, using unary calls");
+
 	return m_clientObj != nullptr;
 }
 
+bool GrpcPlugin::acceptRequestKey(const uint64_t key)
+{
+	if (key == 0)
+		return true;
+
+	std::lock_guard<std::mutex> grd(m_requestKeysMtx);
+
+	if (!m_recentRequestKeys.insert(key).second)
+	{
+		++m_duplicateRequests;
+		return false;
+	}
+
+	m_recentRequestKeyOrder.push_back(key);
+
+	if (m_recentRequestKeyOrder.size() > kRecentRequestKeys)
+	{
+		m_recentRequestKeys.erase(m_recentRequestKeyOrder.front());
+		m_recentRequestKeyOrder.pop_front();
+	}
+
+	return true;
+}
+
+Json GrpcPlugin::getConnectionStats() const
+{
+	Json::object result;
+
+	if (m_clientObj != nullptr)
+		result = m_clientObj->getConnectionStats().object_items();
+
+	result["duplicate_requests"] = double(m_duplicateRequests);
+	return result;
+}
+
 void GrpcPlugin::stop()
 {
+	// The event stream would otherwise hold up the shutdown until its deadline
+	ObsEventStream::instance().stop();
+
 	if (m_server != nullptr)
 	{
-		m_server->Shutdown();
+		// The browser's stream stays open until it exits, don't wait on it forever
+		m_server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
 		m_server->Wait();
 		m_server.reset();
 	}
 
+	if (m_clientObj != nullptr)
+		m_clientObj->shutdown();
+
 	m_clientObj = nullptr;
 	m_serverObj = nullptr;
 	m_builder = nullptr;
+
+	m_payloadRing.close();
+
+	IpcEndpoint::removeSocketFile(m_listenAddress);
 }
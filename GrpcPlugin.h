@@ -1,8 +1,18 @@
 #pragma once
 
 #include "sl_browser_api.grpc.pb.h"
+#include "IpcPayload.h"
+#include "CallbackOutbox.h"
+#include "IpcCompression.h"
+#include "IpcBackoff.h"
+#include "IpcWriteWatchdog.h"
 
+#include <deque>
 #include <filesystem>
+#include <map>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
 
 #include <grpcpp/ext/proto_server_reflection_plugin.h>
 #include <grpcpp/grpcpp.h>
@@ -11,15 +21,86 @@
 class grpc_plugin_objClient
 {
 public:
+	// How long one callback keeps retrying while the browser is unreachable
+	static constexpr std::chrono::seconds kRetryBudget{5};
+
+	// Each unary call and stream write gives up after this, a stalled browser can't hold the outbox past kRetryBudget
+	static constexpr std::chrono::seconds kRpcDeadline{2};
+
+	// Stack block one callback message is built in, the result string is moved in rather than copied
+	static constexpr size_t kArenaBlockSize = 1024;
+
+	// Results given up on are kept this long for the browser's replay, oldest dropped first
+	static constexpr size_t kMaxGivenUpResults = 256;
+	static constexpr size_t kMaxGivenUpBytes = 32 * 1024 * 1024;
+
 	grpc_plugin_objClient(std::shared_ptr<grpc::Channel> channel);
 
-	bool send_executeCallback(const int functionId, const std::string &jsonStr);
-	bool send_executeJavascript(const std::string &codeStr);
+	// Queued, the result is sent from the outbox's thread
+	void send_executeCallback(const int functionId, std::string jsonStr);
+	// Runs in each of browserIds, none means whichever browser most recently made a call
+	bool send_executeJavascript(std::string codeStr, const std::vector<int> &browserIds = {});
 	bool send_windowToggleVisibility();
 
+	bool openStream();
+	void closeStream();
+
+	// Flushes the outbox, then closes the stream
+	void shutdown();
+
+	json11::Json getOutboxStats() const { return m_outbox.stats(); }
+
+	// The browser replayed a request that already ran, sends its result again if it was given up on, see kRetryBudget
+	void resendGivenUp(const int functionId);
+	// A new request reuses functionId, whatever was kept for the old one is stale
+	void forgetGivenUp(const int functionId);
+
+	// { "connected": true, "retries": 0, "reconnects": 0, "given_up": 0, "resent": 0, "stream_fallbacks": 0, "stream_reopens": 0, "write_timeouts": 0 }
+	json11::Json getConnectionStats() const;
+
 private:
+	// Retries with backoff, reconnecting the stream, until kRetryBudget runs out
+	bool deliverCallback(const int functionId, std::string jsonStr);
+	bool sendCallback(grpc_stream_Message &message);
+
+	// False when there's no stream, the caller then falls back to the unary call
+	// A broken stream is reopened here once m_streamBackoff allows, so one failed write doesn't leave everything on unary
+	bool writeStream(grpc_stream_Message &message);
+
+	// These need m_streamMtx held
+	bool openStreamLocked();
+	void resetStreamLocked();
+	bool writeLocked(grpc_stream_Message &message);
+
+	void keepGivenUp(const int functionId, std::string jsonStr);
+
 	std::atomic<bool> m_connected{false};
+	std::atomic<bool> m_stopping{false};
+	std::shared_ptr<grpc::Channel> m_channel;
 	std::unique_ptr<grpc_proxy_obj::Stub> stub_;
+
+	std::atomic<uint64_t> m_retries{0};
+	std::atomic<uint64_t> m_reconnects{0};
+	std::atomic<uint64_t> m_givenUp{0};
+	std::atomic<uint64_t> m_streamFallbacks{0};
+	std::atomic<uint64_t> m_streamReopens{0};
+
+	std::mutex m_streamMtx;
+	uint64_t m_streamSeq = 0;
+	std::unique_ptr<grpc::ClientContext> m_streamContext;
+	std::unique_ptr<grpc::ClientReaderWriter<grpc_stream_Message, grpc_stream_Message>> m_stream;
+	IpcBackoff m_streamBackoff;
+	std::chrono::steady_clock::time_point m_streamRetryAt;
+	IpcWriteWatchdog m_writeWatchdog;
+
+	std::mutex m_givenUpMtx;
+	std::map<int, std::string> m_givenUpResults;
+	std::deque<int> m_givenUpOrder;
+	size_t m_givenUpBytes = 0;
+	std::atomic<uint64_t> m_resent{0};
+
+	// Last, so its sender is joined before anything it uses is destroyed
+	CallbackOutbox m_outbox;
 };
 
 class GrpcPlugin
@@ -31,22 +112,47 @@ public:
 		return a;
 	}
 
-	bool connectToClient(int32_t port);
-	bool startServer(int32_t port);
+	// "localhost:<port>" or "unix:<path>", see IpcEndpoint
+	bool connectToClient(const std::string &address);
+	bool startServer(const std::string &address);
 
 	void stop();
 
+	// False for a request key already seen, the browser replays what it hasn't had an answer for after reconnecting
+	bool acceptRequestKey(const uint64_t key);
+
+	// The client's retry counters plus duplicate_requests
+	json11::Json getConnectionStats() const;
+
 	auto getClient() const { return m_clientObj.get(); }
+	auto &getPayloadRing() { return m_payloadRing; }
+	auto &getCompression() { return m_compression; }
+
+	// From the browser's stream hello
+	bool peerAcceptsCompression() const { return m_peerAcceptsCompression; }
+	void setPeerAcceptsCompression(const bool accepts) { m_peerAcceptsCompression = accepts; }
 
 private:
 	GrpcPlugin();
 	~GrpcPlugin();
 
-	int32_t m_listenPort{0};
+	std::string m_listenAddress;
 
 	std::wstring m_modulePath;
 	std::unique_ptr<grpc::Server> m_server;
 	std::unique_ptr<grpc::ServerBuilder> m_builder;
 	std::unique_ptr<grpc_plugin_obj::Service> m_serverObj;
 	std::unique_ptr<grpc_plugin_objClient> m_clientObj;
+
+	IpcPayloadRing m_payloadRing;
+	IpcCompression m_compression;
+	std::atomic<bool> m_peerAcceptsCompression{false};
+
+	// Enough to cover everything the browser could have pending, see grpc_proxy_objClient::kMaxUnacked
+	static constexpr size_t kRecentRequestKeys = 4096;
+
+	std::mutex m_requestKeysMtx;
+	std::unordered_set<uint64_t> m_recentRequestKeys;
+	std::deque<uint64_t> m_recentRequestKeyOrder;
+	std::atomic<uint64_t> m_duplicateRequests{0};
 };
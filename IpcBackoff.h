@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+#include <grpcpp/support/channel_arguments.h>
+
+// Delay before each reconnect attempt, 10ms doubling up to 1s
+// Up to a quarter of jitter on top so the plugin and browser don't retry in lockstep
+class IpcBackoff
+{
+public:
+	static constexpr std::chrono::milliseconds kInitial{10};
+	static constexpr std::chrono::milliseconds kMax{1000};
+
+	std::chrono::milliseconds next()
+	{
+		const std::chrono::milliseconds base = std::min(kMax, kInitial * (int64_t(1) << std::min(m_attempts, 7)));
+		++m_attempts;
+
+		return base + std::chrono::milliseconds(m_random() % uint32_t(base.count() / 4 + 1));
+	}
+
+	void reset() { m_attempts = 0; }
+	int attempts() const { return m_attempts; }
+
+	// grpc's own reconnect starts at 1s, far too slow for a peer on the same machine
+	static grpc::ChannelArguments channelArguments()
+	{
+		grpc::ChannelArguments args;
+		args.SetInt(GRPC_ARG_INITIAL_RECONNECT_BACKOFF_MS, int(kInitial.count()));
+		args.SetInt(GRPC_ARG_MIN_RECONNECT_BACKOFF_MS, int(kInitial.count()));
+		args.SetInt(GRPC_ARG_MAX_RECONNECT_BACKOFF_MS, int(kMax.count()));
+		return args;
+	}
+
+private:
+	int m_attempts = 0;
+	std::minstd_rand m_random{std::random_device{}()};
+};
@@ -0,0 +1,92 @@
+#include "IpcCompression.h"
+
+#include <chrono>
+#include <cstdlib>
+
+#include <zlib.h>
+
+using namespace json11;
+
+namespace {
+
+uint64_t nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+IpcCompression::IpcCompression()
+{
+	if (const char *value = std::getenv("SL_BROWSER_IPC_COMPRESS_THRESHOLD"))
+		m_threshold = size_t(std::strtoull(value, nullptr, 10));
+}
+
+bool IpcCompression::compress(const std::string &data, std::string &out_compressed)
+{
+	const uint64_t start = nowNs();
+
+	uLongf compressedLength = compressBound(uLong(data.size()));
+	out_compressed.resize(compressedLength);
+
+	// Fastest level, this is about getting it across sooner, not storing it
+	const int result = compress2(reinterpret_cast<Bytef *>(&out_compressed[0]), &compressedLength, reinterpret_cast<const Bytef *>(data.data()), uLong(data.size()), Z_BEST_SPEED);
+
+	m_cpuNs += nowNs() - start;
+
+	// Less than a tenth saved isn't worth the decompress on the other side
+	if (result != Z_OK || compressedLength > data.size() - data.size() / 10)
+	{
+		++m_skipped;
+		out_compressed.clear();
+		return false;
+	}
+
+	out_compressed.resize(compressedLength);
+
+	++m_compressed;
+	m_rawBytes += data.size();
+	m_zlibBytes += compressedLength;
+	return true;
+}
+
+bool IpcCompression::decompress(const std::string &compressed, const size_t originalLength, std::string &out_data)
+{
+	const uint64_t start = nowNs();
+
+	uLongf length = uLongf(originalLength);
+	out_data.resize(originalLength);
+
+	const int result = uncompress(reinterpret_cast<Bytef *>(&out_data[0]), &length, reinterpret_cast<const Bytef *>(compressed.data()), uLong(compressed.size()));
+
+	m_cpuNs += nowNs() - start;
+
+	if (result != Z_OK || length != originalLength)
+	{
+		out_data.clear();
+		return false;
+	}
+
+	++m_decompressed;
+	m_rawBytes += originalLength;
+	m_zlibBytes += compressed.size();
+	return true;
+}
+
+Json IpcCompression::stats() const
+{
+	const uint64_t rawBytes = m_rawBytes;
+	const uint64_t zlibBytes = m_zlibBytes;
+
+	// Compressed size over original
+	const double ratio = rawBytes > 0 ? double(zlibBytes) / double(rawBytes) : 0.0;
+
+	return Json::object{{"threshold", double(m_threshold)},
+			    {"compressed", double(m_compressed)},
+			    {"skipped", double(m_skipped)},
+			    {"decompressed", double(m_decompressed)},
+			    {"raw_bytes", double(rawBytes)},
+			    {"zlib_bytes", double(zlibBytes)},
+			    {"ratio", ratio},
+			    {"cpu_ms", double(m_cpuNs) / 1000000.0}};
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <json11/json11.hpp>
+
+// zlib for large messages that can't use the shared-memory ring, only once the peer said it accepts kEncoding
+// Small messages are never touched, below the threshold compressing costs more than it saves
+class IpcCompression
+{
+public:
+	static constexpr const char *kEncoding = "zlib";
+	static constexpr size_t kDefaultThreshold = 256 * 1024;
+
+	IpcCompression();
+
+	bool shouldCompress(const size_t length) const { return m_threshold != 0 && length >= m_threshold; }
+
+	// False if it didn't shrink enough to be worth it, the caller then sends the original
+	bool compress(const std::string &data, std::string &out_compressed);
+	bool decompress(const std::string &compressed, const size_t originalLength, std::string &out_data);
+
+	// { "threshold": 262144, "compressed": 0, "skipped": 0, "decompressed": 0, "raw_bytes": 0, "zlib_bytes": 0, "ratio": 0.0, "cpu_ms": 0.0 }
+	json11::Json stats() const;
+
+private:
+	// SL_BROWSER_IPC_COMPRESS_THRESHOLD in bytes, 0 turns compression off
+	size_t m_threshold = kDefaultThreshold;
+
+	std::atomic<uint64_t> m_compressed = 0;
+	std::atomic<uint64_t> m_skipped = 0;
+	std::atomic<uint64_t> m_decompressed = 0;
+	std::atomic<uint64_t> m_rawBytes = 0;
+	std::atomic<uint64_t> m_zlibBytes = 0;
+	std::atomic<uint64_t> m_cpuNs = 0;
+};
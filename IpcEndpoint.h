@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+// gRPC addresses shared by GrpcPlugin and GrpcBrowser, either "localhost:<port>" or "unix:<path>"
+namespace IpcEndpoint {
+
+inline bool isUnix(const std::string &address)
+{
+	return address.rfind("unix:", 0) == 0;
+}
+
+inline std::string tcp(const int32_t port)
+{
+	return "localhost:" + std::to_string(port);
+}
+
+// sun_path is 108 bytes, and the path goes through the browser's command line so it has to stay ASCII
+inline std::string unixSocket(const std::string &directory, const std::string &fileName)
+{
+	const std::string path = (std::filesystem::u8path(directory) / fileName).generic_u8string();
+
+	if (path.size() >= 108)
+		return "";
+
+	for (const char c : path)
+	{
+		if ((unsigned char)c >= 0x80 || c == ' ' || c == '"')
+			return "";
+	}
+
+	return "unix:" + path;
+}
+
+// A socket file left behind by a crashed process makes the bind fail
+inline void removeSocketFile(const std::string &address)
+{
+	if (!isUnix(address))
+		return;
+
+	std::error_code ec;
+	std::filesystem::remove(std::filesystem::u8path(address.substr(5)), ec);
+}
+
+// Command line argument, a bare number is a tcp port from before unix sockets were supported
+inline std::string fromArg(const char *arg)
+{
+	const std::string value = arg;
+
+	if (!value.empty() && value.find_first_not_of("0123456789") == std::string::npos)
+		return tcp(atoi(arg));
+
+	return value;
+}
+
+}
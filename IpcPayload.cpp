@@ -0,0 +1,351 @@
+#include "IpcPayload.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr uint32_t kMagic = 0x534C5250; // "SLRP"
+constexpr uint32_t kVersion = 2;
+constexpr uint32_t kBlockUsed = 1;
+constexpr uint32_t kBlockReleased = 2;
+constexpr size_t kHeaderSize = 64;
+// One block header, so capacity, offsets and block sizes are all multiples of it and the gap at the end of the data area is never too small for a padding header
+constexpr size_t kAlignment = 16;
+
+size_t alignUp(const size_t value)
+{
+	return (value + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+}
+
+// Lives at the start of the section, the data area follows at kHeaderSize
+// Positions are monotonic byte counts, the offset into the data area is position % capacity
+struct IpcPayloadRing::Header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+	std::atomic<uint32_t> readerAttached;
+	std::atomic<uint32_t> readerGeneration; // Bumped by every open, the writer drops whatever the previous reader left behind
+	std::atomic<uint64_t> head; // Only the writer moves it
+	std::atomic<uint64_t> tail; // Only the writer moves it, in reclaim
+};
+
+struct IpcPayloadRing::BlockHeader
+{
+	uint32_t size; // Including this header, padded to kAlignment
+	std::atomic<uint32_t> state;
+	uint64_t position; // The full position, a stale one that maps to the same offset after the ring wrapped doesn't match
+};
+
+IpcPayloadRing::~IpcPayloadRing()
+{
+	close();
+}
+
+/*static*/
+std::string IpcPayloadRing::sectionName(const uint32_t ownerPid)
+{
+#ifdef _WIN32
+	return "Local\\sl-browser-payload-" + std::to_string(ownerPid);
+#else
+	return "/sl-browser-payload-" + std::to_string(ownerPid);
+#endif
+}
+
+bool IpcPayloadRing::create(const uint32_t ownerPid, const size_t capacity)
+{
+	close();
+
+	m_name = sectionName(ownerPid);
+	const std::string &name = m_name;
+	const size_t totalSize = kHeaderSize + alignUp(capacity);
+
+#ifdef _WIN32
+	m_mapping = ::CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, DWORD(uint64_t(totalSize) >> 32), DWORD(totalSize), name.c_str());
+
+	if (m_mapping == NULL)
+		return false;
+#else
+	// Leftover from a crashed process with a recycled pid
+	::shm_unlink(name.c_str());
+
+	m_fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+	if (m_fd < 0)
+		return false;
+
+	if (::ftruncate(m_fd, off_t(totalSize)) != 0)
+	{
+		close();
+		return false;
+	}
+#endif
+
+	m_owner = true;
+
+	if (!map(totalSize))
+	{
+		close();
+		return false;
+	}
+
+	m_header->magic = kMagic;
+	m_header->version = kVersion;
+	m_header->capacity = alignUp(capacity);
+	m_header->readerAttached.store(0, std::memory_order_relaxed);
+	m_header->readerGeneration.store(0, std::memory_order_relaxed);
+	m_readerGeneration = 0;
+	m_header->head.store(0, std::memory_order_relaxed);
+	m_header->tail.store(0, std::memory_order_release);
+	return true;
+}
+
+bool IpcPayloadRing::open(const uint32_t ownerPid)
+{
+	close();
+
+	const std::string name = sectionName(ownerPid);
+
+#ifdef _WIN32
+	m_mapping = ::OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+
+	if (m_mapping == NULL)
+		return false;
+
+	// Zero maps the whole section
+	if (!map(0))
+#else
+	m_fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+
+	struct stat st;
+
+	if (m_fd < 0 || ::fstat(m_fd, &st) != 0 || !map(size_t(st.st_size)))
+#endif
+	{
+		close();
+		return false;
+	}
+
+	if (m_header->magic != kMagic || m_header->version != kVersion)
+	{
+		close();
+		return false;
+	}
+
+	m_header->readerGeneration.fetch_add(1, std::memory_order_acq_rel);
+	m_header->readerAttached.store(1, std::memory_order_release);
+	return true;
+}
+
+bool IpcPayloadRing::map(const size_t totalSize)
+{
+	// Both processes touch these through the mapping, they have to be plain lock-free atomics
+	static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+	static_assert(sizeof(Header) <= kHeaderSize, "header must fit before the data area");
+	static_assert(sizeof(BlockHeader) == kAlignment, "a padding block header must fit in any gap at the end of the data area");
+
+	void *view = nullptr;
+
+#ifdef _WIN32
+	view = ::MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, totalSize);
+
+	if (view == nullptr)
+		return false;
+#else
+	if (totalSize < kHeaderSize)
+		return false;
+
+	view = ::mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+
+	if (view == MAP_FAILED)
+		return false;
+#endif
+
+	m_mappedSize = totalSize;
+	m_header = static_cast<Header *>(view);
+	m_data = static_cast<char *>(view) + kHeaderSize;
+	return true;
+}
+
+void IpcPayloadRing::close()
+{
+	if (m_header != nullptr && !m_owner)
+		m_header->readerAttached.store(0, std::memory_order_release);
+
+#ifdef _WIN32
+	if (m_header != nullptr)
+		::UnmapViewOfFile(m_header);
+
+	if (m_mapping != nullptr)
+		::CloseHandle(m_mapping);
+
+	m_mapping = nullptr;
+#else
+	if (m_header != nullptr)
+		::munmap(m_header, m_mappedSize);
+
+	if (m_fd >= 0)
+		::close(m_fd);
+
+	// The name goes away with the creator, mappings already open stay valid
+	if (m_owner && m_fd >= 0)
+		::shm_unlink(m_name.c_str());
+
+	m_fd = -1;
+#endif
+
+	m_header = nullptr;
+	m_data = nullptr;
+	m_mappedSize = 0;
+	m_owner = false;
+	m_name.clear();
+}
+
+bool IpcPayloadRing::readerAttached() const
+{
+	return m_header != nullptr && m_header->readerAttached.load(std::memory_order_acquire) != 0;
+}
+
+IpcPayloadRing::BlockHeader *IpcPayloadRing::blockAt(const uint64_t position) const
+{
+	return reinterpret_cast<BlockHeader *>(m_data + position % m_header->capacity);
+}
+
+IpcPayloadRing::BlockHeader *IpcPayloadRing::liveBlock(const uint64_t position) const
+{
+	const uint64_t head = m_header->head.load(std::memory_order_acquire);
+	const uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+
+	if (position < tail || position >= head)
+		return nullptr;
+
+	BlockHeader *block = blockAt(position);
+
+	if (block->position != position || block->state.load(std::memory_order_acquire) != kBlockUsed)
+		return nullptr;
+
+	return block;
+}
+
+void IpcPayloadRing::reclaim()
+{
+	const uint64_t head = m_header->head.load(std::memory_order_relaxed);
+	uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+
+	// A new reader, everything still outstanding was written for one that's gone and will never be released
+	const uint32_t generation = m_header->readerGeneration.load(std::memory_order_acquire);
+
+	if (generation != m_readerGeneration)
+	{
+		m_readerGeneration = generation;
+		m_header->tail.store(head, std::memory_order_release);
+		return;
+	}
+
+	// Readers can release out of order, the tail only moves past a contiguous run of released blocks
+	while (tail != head)
+	{
+		BlockHeader *block = blockAt(tail);
+
+		if (block->state.load(std::memory_order_acquire) != kBlockReleased)
+			break;
+
+		tail += block->size;
+	}
+
+	m_header->tail.store(tail, std::memory_order_release);
+}
+
+bool IpcPayloadRing::write(const char *data, const size_t length, uint64_t &out_position)
+{
+	if (m_header == nullptr || !m_owner)
+		return false;
+
+	std::lock_guard<std::mutex> grd(m_writeMtx);
+
+	const uint64_t capacity = m_header->capacity;
+	const size_t need = alignUp(sizeof(BlockHeader) + length);
+
+	// Keep room for other payloads, one this large is better off inline
+	if (need > capacity / 2)
+		return false;
+
+	reclaim();
+
+	uint64_t head = m_header->head.load(std::memory_order_relaxed);
+	const uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+	const uint64_t offset = head % capacity;
+
+	// Payloads never wrap, the rest of the data area becomes a released padding block instead
+	const uint64_t padding = capacity - offset < need ? capacity - offset : 0;
+
+	if (head + padding + need - tail > capacity)
+		return false;
+
+	if (padding != 0)
+	{
+		BlockHeader *pad = blockAt(head);
+		pad->size = uint32_t(padding);
+		pad->position = head;
+		pad->state.store(kBlockReleased, std::memory_order_relaxed);
+		head += padding;
+	}
+
+	BlockHeader *block = blockAt(head);
+	block->size = uint32_t(need);
+	block->position = head;
+	memcpy(reinterpret_cast<char *>(block) + sizeof(BlockHeader), data, length);
+	block->state.store(kBlockUsed, std::memory_order_release);
+
+	out_position = head;
+	m_header->head.store(head + need, std::memory_order_release);
+	return true;
+}
+
+bool IpcPayloadRing::read(const uint64_t position, const uint32_t length, std::string &out_data)
+{
+	return read(position, length, [&out_data](const char *data, const size_t size) { out_data.assign(data, size); });
+}
+
+bool IpcPayloadRing::read(const uint64_t position, const uint32_t length, const std::function<void(const char *data, const size_t length)> &use)
+{
+	if (m_header == nullptr)
+		return false;
+
+	BlockHeader *block = liveBlock(position);
+
+	if (block == nullptr || sizeof(BlockHeader) + length > block->size)
+		return false;
+
+	use(reinterpret_cast<const char *>(block) + sizeof(BlockHeader), length);
+	block->state.store(kBlockReleased, std::memory_order_release);
+	return true;
+}
+
+bool IpcPayloadRing::release(const uint64_t position)
+{
+	if (m_header == nullptr)
+		return false;
+
+	// The writer's own give-up path, held so the block can't be reclaimed and reused between the check and the store
+	std::lock_guard<std::mutex> grd(m_writeMtx);
+
+	BlockHeader *block = liveBlock(position);
+
+	if (block == nullptr)
+		return false;
+
+	block->state.store(kBlockReleased, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Shared-memory ring for payloads too large to be worth pushing through gRPC (logs report, file contents, property dumps)
+// The plugin creates it before launching the browser and is the only writer, the browser maps it by the plugin's pid and only reads
+// gRPC then carries just the position and length, the reader releases each block and the writer reclaims them in order
+// A browser that attaches again (it crashed or was restarted) resets the ring, blocks the old one never released don't pin it
+class IpcPayloadRing
+{
+public:
+	static constexpr size_t kDefaultCapacity = 32 * 1024 * 1024;
+
+	// Anything smaller goes inline, the copy costs less than the bookkeeping
+	static constexpr size_t kInlineThreshold = 64 * 1024;
+
+	IpcPayloadRing() {}
+	~IpcPayloadRing();
+
+	bool create(const uint32_t ownerPid, const size_t capacity = kDefaultCapacity);
+	bool open(const uint32_t ownerPid);
+	void close();
+
+	// Writer side, true once a reader has mapped the section
+	bool readerAttached() const;
+
+	// False if the payload doesn't fit right now, the caller sends it inline instead
+	bool write(const char *data, const size_t length, uint64_t &out_position);
+
+	// Copies the block out and releases it, false if position/length don't describe a live block
+	bool read(const uint64_t position, const uint32_t length, std::string &out_data);
+
+	// Same, but hands the block over in place instead of copying it. It's released as soon as use returns
+	bool read(const uint64_t position, const uint32_t length, const std::function<void(const char *data, const size_t length)> &use);
+
+	// For a block that was written but never delivered, false if it was already released or reclaimed
+	bool release(const uint64_t position);
+
+	static std::string sectionName(const uint32_t ownerPid);
+
+private:
+	struct Header;
+	struct BlockHeader;
+
+	IpcPayloadRing(const IpcPayloadRing &) = delete;
+	IpcPayloadRing &operator=(const IpcPayloadRing &) = delete;
+
+	bool map(const size_t totalSize);
+	BlockHeader *blockAt(const uint64_t position) const;
+	// Null unless position is between tail and head and still names an unreleased block
+	BlockHeader *liveBlock(const uint64_t position) const;
+	void reclaim();
+
+	Header *m_header = nullptr;
+	char *m_data = nullptr;
+	size_t m_mappedSize = 0;
+	bool m_owner = false;
+	std::string m_name;
+
+	std::mutex m_writeMtx;
+	uint32_t m_readerGeneration = 0;
+
+#ifdef _WIN32
+	void *m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+};
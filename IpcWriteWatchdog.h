@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <grpcpp/client_context.h>
+
+// Blocking stream writes have no deadline of their own, a peer that stops reading leaves Write waiting on flow control forever
+// Arm before a write and disarm after, a write still running at the deadline has its context cancelled so Write returns false
+class IpcWriteWatchdog
+{
+public:
+	IpcWriteWatchdog() : m_thread([this] { run(); }) {}
+
+	~IpcWriteWatchdog()
+	{
+		{
+			std::lock_guard<std::mutex> grd(m_mtx);
+			m_stopping = true;
+		}
+
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+	void arm(grpc::ClientContext *context, const std::chrono::milliseconds timeout)
+	{
+		{
+			std::lock_guard<std::mutex> grd(m_mtx);
+			m_context = context;
+			m_deadline = std::chrono::steady_clock::now() + timeout;
+		}
+
+		m_cv.notify_all();
+	}
+
+	// Once this returns the context is no longer touched, it can be reset or destroyed
+	void disarm()
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+		m_context = nullptr;
+	}
+
+	uint64_t fired() const { return m_fired; }
+
+private:
+	IpcWriteWatchdog(const IpcWriteWatchdog &) = delete;
+	IpcWriteWatchdog &operator=(const IpcWriteWatchdog &) = delete;
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+
+		while (!m_stopping)
+		{
+			if (m_context == nullptr)
+			{
+				m_cv.wait(lock);
+				continue;
+			}
+
+			// Woken early by a disarm or a new arm, either way look again
+			if (std::chrono::steady_clock::now() < m_deadline)
+			{
+				m_cv.wait_until(lock, m_deadline);
+				continue;
+			}
+
+			// Still under the lock, disarm can't return while the cancel is in progress
+			m_context->TryCancel();
+			m_context = nullptr;
+			++m_fired;
+		}
+	}
+
+	std::mutex m_mtx;
+	std::condition_variable m_cv;
+	grpc::ClientContext *m_context = nullptr;
+	std::chrono::steady_clock::time_point m_deadline;
+	bool m_stopping = false;
+	std::atomic<uint64_t> m_fired{0};
+
+	// Last, it starts running in the constructor
+	std::thread m_thread;
+};
@@ -1,7 +1,60 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <string>
-#include <map>
+#include <string_view>
+
+// Open-addressed name -> entry tables over the constexpr function lists, lookups don't allocate or copy
+namespace JavascriptApiLookup
+{
+constexpr size_t kSlotCount = 256;
+
+// FNV-1a
+constexpr uint32_t hashName(const std::string_view str)
+{
+	uint32_t hash = 2166136261u;
+
+	for (char c : str)
+		hash = (hash ^ uint8_t(c)) * 16777619u;
+
+	return hash;
+}
+
+// Each slot holds the entry index + 1, zero is empty
+template<typename Entry, size_t N> constexpr std::array<uint8_t, kSlotCount> buildSlots(const Entry (&entries)[N])
+{
+	static_assert(N < kSlotCount / 2, "Grow kSlotCount, the table should stay under half full");
+
+	std::array<uint8_t, kSlotCount> slots{};
+
+	for (size_t i = 0; i < N; ++i)
+	{
+		size_t slot = hashName(entries[i].name) & (kSlotCount - 1);
+
+		while (slots[slot] != 0)
+			slot = (slot + 1) & (kSlotCount - 1);
+
+		slots[slot] = uint8_t(i + 1);
+	}
+
+	return slots;
+}
+
+template<typename Entry, size_t N> constexpr const Entry *find(const Entry (&entries)[N], const std::array<uint8_t, kSlotCount> &slots, const std::string_view name)
+{
+	for (size_t slot = hashName(name) & (kSlotCount - 1); slots[slot] != 0; slot = (slot + 1) & (kSlotCount - 1))
+	{
+		const Entry &entry = entries[slots[slot] - 1];
+
+		if (entry.name == name)
+			return &entry;
+	}
+
+	return nullptr;
+}
+}
 
 class JavascriptApi
 {
@@ -63,6 +116,7 @@ public:
 		JS_SET_SCENEITEM_BLENDING_MODE,
 		JS_SET_SCENEITEM_BLENDING_METHOD,
 		JS_SET_SCALE,				
+		JS_COMMIT_SCENEITEM_TRANSFORMS,
 		JS_GET_SCENEITEM_POS,
 		JS_GET_SCENEITEM_ROT,
 		JS_GET_SCENEITEM_CROP,
@@ -91,15 +145,54 @@ public:
 		JS_QT_SET_JS_ON_CLICK_STREAM,
 		JS_QT_INVOKE_CLICK_ON_STREAM_BUTTON,
 		JS_BROWSER_SET_HIDDEN_STATE,
+		JS_BATCH,
+		JS_CALL_WITH_PRIORITY,
+		JS_GET_PERF_STATS,
+		JS_BROWSER_GET_IPC_HEALTH,
+		JS_BROWSER_SUBSCRIBE_EVENTS,
+		JS_BROWSER_UNSUBSCRIBE_EVENTS,
+
+		// Keep last, sizes per-function tables
+		JS_FUNCS_COUNT,
+	};
+
+	// How the plugin is allowed to schedule a function relative to the others
+	enum JSFuncClass
+	{
+		// Changes OBS/Qt state, these run one at a time in the order they arrived
+		JS_CLASS_MUTATE = 0,
+
+		// Only queries state, these may run concurrently with each other
+		JS_CLASS_READ,
+
+		// Blocks on disk or network without touching OBS, these get their own threads
+		JS_CLASS_IO,
+	};
+
+	// Order in which queued reads and IO requests are picked up. Mutations always run in the order they were sent
+	// A "high" mutation instead stops the read and IO lanes starting anything but "high" work until it's done, so it isn't stuck behind them for the main thread
+	// A read of any priority still waits for every mutation sent before it, so a "high" read can't jump a queue of mutations
+	enum JSFuncPriority
+	{
+		JS_PRIORITY_HIGH = 0,
+		JS_PRIORITY_NORMAL,
+		JS_PRIORITY_LOW,
+		JS_PRIORITY_COUNT,
+	};
+
+	struct JSFuncEntry
+	{
+		std::string_view name;
+		JSFuncs id;
 	};
 
 public:
 
 	// Control over the plugin/OBS side
-	static std::map<std::string, JSFuncs> &getPluginFunctionNames()
+	static const auto &getPluginFunctionNames()
 	{
 		// None of the api function belows are blocking, they return immediatelly, but can accept a function as arg1 thats invoked when work is complete, which should allow await/promise structure
-		static std::map<std::string, JSFuncs> names =
+		static constexpr JSFuncEntry names[] =
 		{
 			/***
 			* Docks
@@ -227,10 +320,15 @@ public:
 			// .(@function(arg1), @filepath)
 			//	Returns the contents of a file as a string. If the filesize is over 1mb this will return an error
 			//		Example arg1 = { "contents": "..." }
+			// .(@function(arg1, arg2), @filepath, @offset, @length)
+			//	Given an offset, reads up to 'length' bytes from there (2mb at most, 0 for as much as that) with no limit on the filesize
+			//	arg2 is an ArrayBuffer of the bytes, read the rest by calling again with offset + length until eof
+			//		Example arg1 = { "offset": 0, "length": 2097152, "size": 20971520, "eof": false }
+			//	slabsGlobal.async.fs_readFile(@filepath, @offset, @length) resolves with { "offset", "length", "size", "eof", "data": ArrayBuffer }
 			{"fs_readFile", JS_READ_FILE},
 
 			// .(@function(arg1), @filepaths_jsonStr)
-			//	Json string, array, [{ path: "..." },] paths must be relative to the streamlabs download folder, ie "/download1234/file.png"
+			//	Array, [{ path: "..." },] paths must be relative to the streamlabs download folder, ie "/download1234/file.png"
 			{"fs_deleteFiles", JS_DELETE_FILES},
 
 			// .(@function(arg1), @path)
@@ -345,6 +443,12 @@ public:
 			// .(@function(arg1), @sceneName, @sourceName, @decimal_x, @decimal_y)
 			{"obs_sceneitem_set_scale", JS_SET_SCALE},
 
+			// .(@function(arg1), @transforms_jsonStr)
+			//	Json string, array, [{ scene: "...", source: "...", pos: { x, y }, rot, scale: { x, y }, crop: { left, top, right, bottom }, alignment, bounds: { type, alignment, x, y } },]
+			//	Every field but scene/source is optional, as is every key inside pos/scale/crop/bounds (missing ones keep their current value), items in the same scene are updated together so no frame shows a partial change
+			//		Example arg1 = [{ }, { "error": "Failed find the source in that scene" }]
+			{"obs_sceneitems_commit_transforms", JS_COMMIT_SCENEITEM_TRANSFORMS},
+
 			// .(@function(arg1), @sceneName, @sourceName, @int_scaleType)
 			//	OBS_SCALE_DISABLE = 1
 			//	OBS_SCALE_POINT = 2
@@ -484,16 +588,38 @@ public:
 			//	DEV NOTE: THIS FUNCTION CAN NEVER BE RENAMED !!
 			{"sl_getVersionInfo", JS_SL_VERSION_INFO},
 
+			// .(@function(arg1), @calls_jsonStr)
+			//	Json string, array, [{ funcname: "...", params: [...] },] params are what would follow arg1 in a direct call
+			//	Runs every call in a single trip to the main thread, results are returned in the same order
+			//	Only scene item transform, visibility, crop, scale filter and blending calls (set and get), obs_source_get_dimensions and filter add/remove
+			//	can be batched, anything else is rejected per entry
+			//		Example @calls_jsonStr = [{ "funcname": "obs_sceneitem_set_pos", "params": ["Scene", "Item", 10, 20] }, { "funcname": "obs_sceneitem_get_pos", "params": ["Scene", "Item"] }]
+			//		Example arg1 = [{ }, { "x": 10, "y": 20 }]
+			{"batch", JS_BATCH},
+
+			// .(@function(arg1))
+			//	Latency percentiles per function and stage (queue, parse, hop, handler, callback) since startup, plus the state of the IPC queues
+			//		Example arg1 = { "functions": { "obs_sceneitem_set_pos": { "handler": { "count": 12, "mean_us": 210.5, "p50_us": 192.0, "p90_us": 256.0, "p99_us": 384.0, "max_us": 402.1 }, ... }, ... },
+			//		                 "ipc": { "callback_outbox": { "depth": 0, "bytes": 0, "peak_depth": 3, "sent": 40, "failed": 0, "blocked": 0, "blocked_ms": 0.0 },
+			//		                          "compression": { "threshold": 262144, "compressed": 2, "skipped": 0, "decompressed": 0, "raw_bytes": 4194304, "zlib_bytes": 524288, "ratio": 0.125, "cpu_ms": 9.5 },
+			//		                          "connection": { "connected": true, "retries": 0, "reconnects": 0, "given_up": 0, "resent": 0, "stream_fallbacks": 0, "stream_reopens": 0, "write_timeouts": 0, "duplicate_requests": 0 } } }
+			{"sl_getPerfStats", JS_GET_PERF_STATS},
+
+			// .(@function(arg1), @priority, @funcname, ...)
+			//	Calls @funcname with the remaining arguments at "high", "normal" or "low" priority instead of its default
+			//	Reorders reads and file/network calls. Anything that changes OBS state keeps its place in line, "high" only holds back reads and file/network calls until it has run
+			//	Unwrapped by the browser process, the plugin only ever sees @funcname
+			{"sl_callWithPriority", JS_CALL_WITH_PRIORITY},
 		};
 
 		return names;
 	}
 
 	// Control over our the browser
-	static std::map<std::string, JSFuncs> &getBrowserFunctionNames()
+	static const auto &getBrowserFunctionNames()
 	{
 		// None of the api function belows are blocking, they return immediatelly, but can accept a function as arg1 thats invoked when work is complete, which should allow await/promise structure
-		static std::map<std::string, JSFuncs> names =
+		static constexpr JSFuncEntry names[] =
 		{
 			/**
 			* Browser Window
@@ -515,42 +641,233 @@ public:
 			// .(@function(arg1), bool)`
 			//	DEV NOTE: THIS FUNCTION MUST NEVER BE RENAMED !!
 			{"browser_setHiddenState", JS_BROWSER_SET_HIDDEN_STATE},
+
+			// .(@function(arg1))`
+			//	The browser's link to the plugin, pending requests are replayed once it reconnects
+			//		Example arg1 = { "connected": true, "disconnects": 1, "reconnect_attempts": 3, "replayed": 2, "pending": 0, "pending_bytes": 0,
+			//		                 "queued_while_down": 2, "rejected": 0, "last_outage_ms": 42.5, "total_outage_ms": 42.5, "stream_fallbacks": 0, "stream_reopens": 0,
+			//		                 "stream_resets": 0, "write_timeouts": 0,
+			//		                 "callbacks": { "pending": 3, "peak_pending": 40, "expired": 0, "rejected": 0 },
+			//		                 "renderer_callbacks": { "pending": 3, "peak_pending": 40, "expired": 0, "rejected": 0 } }
+			//	A callback still pending after 60 seconds (10 minutes for downloads, file access and fs_installFont) is called with { "error": "Timed out waiting for a result" }
+			{"browser_getIpcHealth", JS_BROWSER_GET_IPC_HEALTH},
+
+			/**
+			* OBS Events
+			*/
+
+			// .(@function(arg1), @events_jsonStr)`
+			//	Json string, array of names from s_obsEvents, an empty array subscribes to all of them
+			//	Each event is then dispatched on window as a CustomEvent named "slabs:<name>", its detail is the payload documented in s_obsEvents
+			//		Example @events_jsonStr = ["scene_switched", "streaming_started", "streaming_stopped"]
+			//		Example window.addEventListener("slabs:scene_switched", (e) => console.log(e.detail.scene))
+			//		Example arg1 = { "subscribed": ["scene_switched", "streaming_started", "streaming_stopped"] }
+			//	Subscriptions end when the page navigates away
+			{"browser_subscribeEvents", JS_BROWSER_SUBSCRIBE_EVENTS},
+
+			// .(@function(arg1), @events_jsonStr)`
+			//	Json string, array of names, an empty array unsubscribes from everything
+			//		Example arg1 = { "subscribed": ["scene_switched"] }
+			{"browser_unsubscribeEvents", JS_BROWSER_UNSUBSCRIBE_EVENTS},
 		};
 
 		return names;
 	}
 
-	static bool isValidFunctionName(const std::string &str)
+	// Pushed from the plugin as OBS reports them, see browser_subscribeEvents
+	static constexpr std::string_view s_obsEvents[] =
+	{
+		// { "scene": "Scene 2" }
+		"scene_switched",
+
+		// {}
+		"streaming_started",
+		"streaming_stopped",
+		"recording_started",
+		"recording_stopped",
+
+		// { "source": "Webcam", "id": "dshow_input" }, only sources that are user visible
+		"source_created",
+
+		// { "source": "Webcam" }
+		"source_removed",
+
+		// { "collection": "Untitled" }
+		"scene_collection_changed",
+	};
+
+	static bool isValidFunctionName(const std::string_view str)
 	{
 		return isPluginFunctionName(str) || isBrowserFunctionName(str); 
 	}
 
-	static bool isPluginFunctionName(const std::string &str)
+	static bool isPluginFunctionName(const std::string_view str)
+	{
+		return findPluginFunction(str) != nullptr;
+	}
+
+	static bool isBrowserFunctionName(const std::string_view str)
+	{
+		return findBrowserFunction(str) != nullptr;
+	}
+
+	static bool isObsEventName(const std::string_view str)
+	{
+		for (auto &itr : s_obsEvents)
+		{
+			if (itr == str)
+				return true;
+		}
+
+		return false;
+	}
+
+	static JSFuncClass getFunctionClass(const JSFuncs id)
 	{
-		auto ref = getPluginFunctionNames();
-		return ref.find(str) != ref.end();
+		switch (id)
+		{
+		case JS_DOWNLOAD_ZIP:
+		case JS_DOWNLOAD_FILE:
+		case JS_READ_FILE:
+		case JS_DELETE_FILES:
+		case JS_DROP_FOLDER:
+		case JS_QUERY_DOWNLOADS_FOLDER:
+		case JS_GET_LOGS_REPORT_STRING:
+			return JS_CLASS_IO;
+
+		case JS_QUERY_DOCKS:
+		case JS_GET_MAIN_WINDOW_GEOMETRY:
+		case JS_GET_STREAMSETTINGS:
+		case JS_SL_VERSION_INFO:
+		case JS_GET_AUTH_TOKEN:
+		case JS_GET_CURRENT_SCENE:
+		case JS_SCENE_GET_SOURCES:
+		case JS_QUERY_ALL_SOURCES:
+		case JS_ENUM_SCENES:
+		case JS_SOURCE_GET_PROPERTIES:
+		case JS_SOURCE_GET_SETTINGS:
+		case JS_TRANSITION_GET_SETTINGS:
+		case JS_GET_SCENE_COLLECTIONS:
+		case JS_GET_CURRENT_SCENE_COLLECTION:
+		case JS_GET_SCENEITEM_POS:
+		case JS_GET_SCENEITEM_ROT:
+		case JS_GET_SCENEITEM_CROP:
+		case JS_GET_SCENEITEM_SCALE_FILTER:
+		case JS_GET_SCENEITEM_BLENDING_MODE:
+		case JS_GET_SCENEITEM_BLENDING_METHOD:
+		case JS_GET_SCALE:
+		case JS_GET_SOURCE_DIMENSIONS:
+		case JS_GET_CANVAS_DIMENSIONS:
+		case JS_GET_IS_OBS_STREAMING:
+		case JS_GET_PERF_STATS:
+			return JS_CLASS_READ;
+
+		default:
+			// Anything unlisted is assumed to change state, that's the safe default
+			return JS_CLASS_MUTATE;
+		}
 	}
 
-	static bool isBrowserFunctionName(const std::string &str)
+	static JSFuncPriority getFunctionPriority(const JSFuncs id)
 	{
-		auto ref = getBrowserFunctionNames();
-		return ref.find(str) != ref.end();
+		switch (id)
+		{
+		// Things a streamer notices the moment they lag during a live show
+		case JS_GET_IS_OBS_STREAMING:
+		case JS_QT_INVOKE_CLICK_ON_STREAM_BUTTON:
+		case JS_SET_CURRENT_SCENE:
+			return JS_PRIORITY_HIGH;
+
+		case JS_DOWNLOAD_ZIP:
+		case JS_DOWNLOAD_FILE:
+		case JS_GET_LOGS_REPORT_STRING:
+		case JS_SOURCE_GET_PROPERTIES:
+		case JS_QUERY_ALL_SOURCES:
+			return JS_PRIORITY_LOW;
+
+		default:
+			return JS_PRIORITY_NORMAL;
+		}
 	}
 
-	static JSFuncs getFunctionId(const std::string &funcName)
+	// What batch accepts, quick OBS setters and getters on scene items and filters
+	// Anything that can block (files, downloads, fonts, the web server, restarting) would hold the main thread for the whole batch
+	static bool isBatchable(const JSFuncs id)
 	{
-		auto ref = getPluginFunctionNames();
-		auto itr = ref.find(funcName);
+		switch (id)
+		{
+		case JS_SET_SCENEITEM_POS:
+		case JS_SET_SCENEITEM_ROT:
+		case JS_SET_SCENEITEM_VISIBILITY:
+		case JS_SET_SCENEITEM_CROP:
+		case JS_SET_SCENEITEM_SCALE_FILTER:
+		case JS_SET_SCENEITEM_BLENDING_MODE:
+		case JS_SET_SCENEITEM_BLENDING_METHOD:
+		case JS_SET_SCALE:
+		case JS_COMMIT_SCENEITEM_TRANSFORMS:
+		case JS_GET_SCENEITEM_POS:
+		case JS_GET_SCENEITEM_ROT:
+		case JS_GET_SCENEITEM_CROP:
+		case JS_GET_SCENEITEM_SCALE_FILTER:
+		case JS_GET_SCENEITEM_BLENDING_MODE:
+		case JS_GET_SCENEITEM_BLENDING_METHOD:
+		case JS_GET_SCALE:
+		case JS_GET_SOURCE_DIMENSIONS:
+		case JS_SOURCE_FILTER_ADD:
+		case JS_SOURCE_FILTER_REMOVE:
+			return true;
+
+		default:
+			return false;
+		}
+	}
 
-		if (itr != ref.end())
-			return itr->second;
+	// How long the page waits for a result before the call is rejected as timed out
+	static std::chrono::seconds getFunctionTimeout(const JSFuncs id)
+	{
+		// Downloads, font installs and big chunked reads can legitimately take minutes
+		if (getFunctionClass(id) == JS_CLASS_IO || id == JS_INSTALL_FONT)
+			return std::chrono::minutes(10);
 
-		ref = getBrowserFunctionNames();
-		itr = ref.find(funcName);
+		return std::chrono::seconds(60);
+	}
 
-		if (itr != ref.end())
-			return itr->second;
+	static bool getPriorityFromName(const std::string_view name, JSFuncPriority &out_priority)
+	{
+		if (name == "high")
+			out_priority = JS_PRIORITY_HIGH;
+		else if (name == "normal")
+			out_priority = JS_PRIORITY_NORMAL;
+		else if (name == "low")
+			out_priority = JS_PRIORITY_LOW;
+		else
+			return false;
+
+		return true;
+	}
+
+	static JSFuncs getFunctionId(const std::string_view funcName)
+	{
+		if (auto entry = findPluginFunction(funcName))
+			return entry->id;
+
+		if (auto entry = findBrowserFunction(funcName))
+			return entry->id;
 
 		return JS_INVALID;
 	}
+
+private:
+	// The slots are built once, on first use, every lookup after that is a hash and usually one compare
+	static const JSFuncEntry *findPluginFunction(const std::string_view name)
+	{
+		static const auto slots = JavascriptApiLookup::buildSlots(getPluginFunctionNames());
+		return JavascriptApiLookup::find(getPluginFunctionNames(), slots, name);
+	}
+
+	static const JSFuncEntry *findBrowserFunction(const std::string_view name)
+	{
+		static const auto slots = JavascriptApiLookup::buildSlots(getBrowserFunctionNames());
+		return JavascriptApiLookup::find(getBrowserFunctionNames(), slots, name);
+	}
 };
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+
+#include <json11/json11.hpp>
+
+// Decodes a request's positional arguments (param2..N, param1 is the callback) straight into typed handler locals
+// Each handler declares its signature once, in the bindArgs call, instead of pulling and converting paramN by hand
+namespace JsArgBinder {
+
+inline bool decode(const json11::Json &value, std::string &out)
+{
+	if (!value.is_string())
+		return false;
+
+	out = value.string_value();
+	return true;
+}
+
+inline bool decode(const json11::Json &value, double &out)
+{
+	if (!value.is_number())
+		return false;
+
+	out = value.number_value();
+	return true;
+}
+
+inline bool decode(const json11::Json &value, float &out)
+{
+	if (!value.is_number())
+		return false;
+
+	out = float(value.number_value());
+	return true;
+}
+
+inline bool decode(const json11::Json &value, int &out)
+{
+	if (!value.is_number())
+		return false;
+
+	out = value.int_value();
+	return true;
+}
+
+inline bool decode(const json11::Json &value, bool &out)
+{
+	if (!value.is_bool())
+		return false;
+
+	out = value.bool_value();
+	return true;
+}
+
+inline const char *typeName(const std::string &) { return "string"; }
+inline const char *typeName(const double &) { return "number"; }
+inline const char *typeName(const float &) { return "number"; }
+inline const char *typeName(const int &) { return "number"; }
+inline const char *typeName(const bool &) { return "bool"; }
+
+template<typename T> bool bindOne(const json11::Json &params, const int index, std::string &out_jsonReturn, T &out)
+{
+	const std::string key = "param" + std::to_string(index);
+
+	if (decode(params[key], out))
+		return true;
+
+	out_jsonReturn = json11::Json(json11::Json::object({{"error", "Invalid parameter " + key + ", expected " + typeName(out)}})).dump();
+	return false;
+}
+
+// Fills args in order from param2 onward, on the first mismatch out_jsonReturn gets the error and false is returned
+template<typename... Args> bool bindArgs(const json11::Json &params, std::string &out_jsonReturn, Args &...args)
+{
+	int index = 2;
+	bool ok = true;
+	((ok = ok && bindOne(params, index++, out_jsonReturn, args)), ...);
+	return ok;
+}
+
+}
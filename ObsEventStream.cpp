@@ -0,0 +1,149 @@
+#include "ObsEventStream.h"
+
+#include <obs.hpp>
+
+using namespace json11;
+
+void ObsEventStream::connect()
+{
+	signal_handler_t *handler = obs_get_signal_handler();
+	signal_handler_connect(handler, "source_create", onSourceCreated, this);
+	signal_handler_connect(handler, "source_remove", onSourceRemoved, this);
+}
+
+void ObsEventStream::disconnect()
+{
+	signal_handler_t *handler = obs_get_signal_handler();
+	signal_handler_disconnect(handler, "source_create", onSourceCreated, this);
+	signal_handler_disconnect(handler, "source_remove", onSourceRemoved, this);
+}
+
+void ObsEventStream::stop()
+{
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+		m_stopped = true;
+		m_queue.clear();
+	}
+
+	m_cv.notify_all();
+}
+
+uint64_t ObsEventStream::subscribe()
+{
+	uint64_t subscription = 0;
+
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+		subscription = ++m_subscription;
+		m_queue.clear();
+	}
+
+	// Wakes the stream this one replaces
+	m_cv.notify_all();
+	return subscription;
+}
+
+ObsEventStream::WaitResult ObsEventStream::next(const uint64_t subscription, Event &out_event, const std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+
+	auto ready = [this, subscription] { return !m_queue.empty() || m_subscription != subscription || m_stopped; };
+
+	if (!m_cv.wait_for(lock, timeout, ready))
+		return WAIT_TIMEOUT;
+
+	if (m_subscription != subscription || m_stopped)
+		return WAIT_CLOSED;
+
+	out_event = std::move(m_queue.front());
+	m_queue.pop_front();
+	return WAIT_EVENT;
+}
+
+void ObsEventStream::publish(const char *name, const Json &data)
+{
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+
+		// Nobody listening
+		if (m_subscription == 0 || m_stopped)
+			return;
+
+		// The gap in seq tells the browser
+		if (m_queue.size() >= kMaxQueued)
+			m_queue.pop_front();
+
+		Event event;
+		event.seq = ++m_seq;
+		event.name = name;
+		event.jsonStr = data.dump();
+		m_queue.push_back(std::move(event));
+	}
+
+	m_cv.notify_all();
+}
+
+/***
+* OBS Callbacks
+**/
+
+/*static*/
+void ObsEventStream::handle_obs_frontend_event(obs_frontend_event event, void *)
+{
+	ObsEventStream &self = instance();
+
+	switch (event)
+	{
+	case OBS_FRONTEND_EVENT_SCENE_CHANGED:
+	{
+		OBSSourceAutoRelease scene = obs_frontend_get_current_scene();
+		self.publish("scene_switched", Json::object{{"scene", scene != nullptr ? obs_source_get_name(scene) : ""}});
+		break;
+	}
+	case OBS_FRONTEND_EVENT_STREAMING_STARTED:
+		self.publish("streaming_started", Json::object{});
+		break;
+	case OBS_FRONTEND_EVENT_STREAMING_STOPPED:
+		self.publish("streaming_stopped", Json::object{});
+		break;
+	case OBS_FRONTEND_EVENT_RECORDING_STARTED:
+		self.publish("recording_started", Json::object{});
+		break;
+	case OBS_FRONTEND_EVENT_RECORDING_STOPPED:
+		self.publish("recording_stopped", Json::object{});
+		break;
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED:
+	{
+		char *collection = obs_frontend_get_current_scene_collection();
+		self.publish("scene_collection_changed", Json::object{{"collection", collection != nullptr ? collection : ""}});
+		bfree(collection);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+/*static*/
+void ObsEventStream::onSourceCreated(void *data, calldata_t *params)
+{
+	obs_source_t *source = static_cast<obs_source_t *>(calldata_ptr(params, "source"));
+
+	// Transitions' internals, previews and the like aren't anything a page can address
+	if (source == nullptr || obs_obj_is_private(source) || obs_source_get_name(source) == nullptr)
+		return;
+
+	static_cast<ObsEventStream *>(data)->publish("source_created", Json::object{{"source", obs_source_get_name(source)}, {"id", obs_source_get_id(source)}});
+}
+
+/*static*/
+void ObsEventStream::onSourceRemoved(void *data, calldata_t *params)
+{
+	obs_source_t *source = static_cast<obs_source_t *>(calldata_ptr(params, "source"));
+
+	if (source == nullptr || obs_obj_is_private(source) || obs_source_get_name(source) == nullptr)
+		return;
+
+	static_cast<ObsEventStream *>(data)->publish("source_removed", Json::object{{"source", obs_source_get_name(source)}});
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include <obs.h>
+#include <obs-frontend-api.h>
+
+#include <json11/json11.hpp>
+
+// OBS frontend events and libobs signals queued for the browser's com_grpc_events stream, see JavascriptApi::s_obsEvents
+// Publishing never blocks the UI or libobs thread that raised the event, a full queue drops its oldest
+class ObsEventStream
+{
+public:
+	static constexpr size_t kMaxQueued = 1024;
+
+	enum WaitResult
+	{
+		WAIT_EVENT = 0,
+		WAIT_TIMEOUT,
+
+		// Superseded by a newer subscription, or stopped
+		WAIT_CLOSED,
+	};
+
+	struct Event
+	{
+		uint64_t seq = 0;
+		std::string name;
+		std::string jsonStr;
+	};
+
+	static ObsEventStream &instance()
+	{
+		static ObsEventStream a;
+		return a;
+	}
+
+	void connect();
+	void disconnect();
+
+	// Ends any stream still waiting in next
+	void stop();
+
+	// Events raised before the browser subscribed belong to nobody, they're discarded
+	// There's one subscriber at a time, a newer one (a second browser process, a bench client) silently ends the previous one's stream
+	uint64_t subscribe();
+	WaitResult next(const uint64_t subscription, Event &out_event, const std::chrono::milliseconds timeout);
+
+	void publish(const char *name, const json11::Json &data);
+
+	static void handle_obs_frontend_event(enum obs_frontend_event event, void *data);
+
+private:
+	ObsEventStream() {}
+	~ObsEventStream() {}
+
+	static void onSourceCreated(void *data, calldata_t *params);
+	static void onSourceRemoved(void *data, calldata_t *params);
+
+	std::mutex m_mtx;
+	std::condition_variable m_cv;
+	std::deque<Event> m_queue;
+	uint64_t m_subscription = 0;
+	uint64_t m_seq = 0;
+	bool m_stopped = false;
+};
@@ -0,0 +1,192 @@
+#include "PerfStats.h"
+
+#include <obs.h>
+#include <json11/json11.hpp>
+
+#include <algorithm>
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace json11;
+
+namespace {
+
+struct RequestContext
+{
+	JavascriptApi::JSFuncs funcId = JavascriptApi::JS_INVALID;
+	uint64_t hopNs = 0;
+};
+
+thread_local RequestContext t_requestContext;
+
+const char *const kStageNames[PerfStats::STAGE_COUNT] = {"queue", "parse", "hop", "handler", "callback"};
+
+int floorLog2(const uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return int(index);
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+}
+
+void PerfStats::beginRequest(const JavascriptApi::JSFuncs funcId)
+{
+	t_requestContext.funcId = funcId;
+	t_requestContext.hopNs = 0;
+}
+
+JavascriptApi::JSFuncs PerfStats::currentRequest()
+{
+	return t_requestContext.funcId;
+}
+
+void PerfStats::addHopTime(const uint64_t ns)
+{
+	t_requestContext.hopNs += ns;
+}
+
+uint64_t PerfStats::takeHopTime()
+{
+	uint64_t hopNs = t_requestContext.hopNs;
+	t_requestContext.hopNs = 0;
+	return hopNs;
+}
+
+/*static*/
+int PerfStats::bucketIndex(const uint64_t ns)
+{
+	if (ns < kSubBucketCount)
+		return int(ns);
+
+	const int exponent = floorLog2(ns);
+
+	if (exponent > kMaxExponent)
+		return kBucketCount - 1;
+
+	const int subBucket = int(ns >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+	return kSubBucketCount + (exponent - kSubBucketBits) * kSubBucketCount + subBucket;
+}
+
+/*static*/
+uint64_t PerfStats::bucketUpperBound(const int index)
+{
+	if (index < kSubBucketCount)
+		return uint64_t(index) + 1;
+
+	const int exponent = (index - kSubBucketCount) / kSubBucketCount + kSubBucketBits;
+	const int subBucket = (index - kSubBucketCount) % kSubBucketCount;
+	return uint64_t(kSubBucketCount + subBucket + 1) << (exponent - kSubBucketBits);
+}
+
+void PerfStats::record(const JavascriptApi::JSFuncs funcId, const Stage stage, const uint64_t ns)
+{
+	if (funcId <= JavascriptApi::JS_INVALID || funcId >= JavascriptApi::JS_FUNCS_COUNT)
+		return;
+
+	Histogram &histogram = m_histograms[funcId][stage];
+
+	// Relaxed is enough, readers only want a consistent-enough snapshot and this sits on every request
+	histogram.buckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+	histogram.count.fetch_add(1, std::memory_order_relaxed);
+	histogram.sumNs.fetch_add(ns, std::memory_order_relaxed);
+
+	uint64_t prevMax = histogram.maxNs.load(std::memory_order_relaxed);
+
+	while (ns > prevMax && !histogram.maxNs.compare_exchange_weak(prevMax, ns, std::memory_order_relaxed))
+		;
+}
+
+/*static*/
+double PerfStats::percentileUs(const Histogram &histogram, const uint64_t count, const double percentile)
+{
+	const uint64_t target = uint64_t(percentile * double(count - 1)) + 1;
+	uint64_t seen = 0;
+
+	for (int i = 0; i < kBucketCount; ++i)
+	{
+		seen += histogram.buckets[i].load(std::memory_order_relaxed);
+
+		// Report the bucket's upper bound, but never more than what was actually seen
+		if (seen >= target)
+			return double(std::min(bucketUpperBound(i), histogram.maxNs.load(std::memory_order_relaxed))) / 1000.0;
+	}
+
+	return double(histogram.maxNs.load(std::memory_order_relaxed)) / 1000.0;
+}
+
+Json PerfStats::toJson() const
+{
+	Json::object functions;
+
+	for (const auto &entry : JavascriptApi::getPluginFunctionNames())
+	{
+		Json::object stages;
+
+		for (int stage = 0; stage < STAGE_COUNT; ++stage)
+		{
+			const Histogram &histogram = m_histograms[entry.id][stage];
+			const uint64_t count = histogram.count.load(std::memory_order_relaxed);
+
+			if (count == 0)
+				continue;
+
+			stages[kStageNames[stage]] = Json::object{{"count", double(count)},
+								  {"mean_us", double(histogram.sumNs.load(std::memory_order_relaxed)) / double(count) / 1000.0},
+								  {"p50_us", percentileUs(histogram, count, 0.50)},
+								  {"p90_us", percentileUs(histogram, count, 0.90)},
+								  {"p99_us", percentileUs(histogram, count, 0.99)},
+								  {"max_us", double(histogram.maxNs.load(std::memory_order_relaxed)) / 1000.0}};
+		}
+
+		if (!stages.empty())
+			functions[std::string(entry.name)] = stages;
+	}
+
+	return functions;
+}
+
+void PerfStats::logSummary()
+{
+	uint64_t totalCount = 0;
+
+	for (const auto &entry : JavascriptApi::getPluginFunctionNames())
+		totalCount += m_histograms[entry.id][STAGE_HANDLER].count.load(std::memory_order_relaxed);
+
+	if (totalCount == m_lastSummaryCount)
+		return;
+
+	m_lastSummaryCount = totalCount;
+
+	for (const auto &entry : JavascriptApi::getPluginFunctionNames())
+	{
+		const uint64_t count = m_histograms[entry.id][STAGE_HANDLER].count.load(std::memory_order_relaxed);
+
+		if (count == 0)
+			continue;
+
+		std::string line;
+
+		for (int stage = 0; stage < STAGE_COUNT; ++stage)
+		{
+			const Histogram &histogram = m_histograms[entry.id][stage];
+			const uint64_t stageCount = histogram.count.load(std::memory_order_relaxed);
+
+			if (stageCount == 0)
+				continue;
+
+			char buf[128];
+			snprintf(buf, sizeof(buf), " %s p50/p99 %.1f/%.1fus", kStageNames[stage], percentileUs(histogram, stageCount, 0.50), percentileUs(histogram, stageCount, 0.99));
+			line += buf;
+		}
+
+		blog(LOG_INFO, "PerfStats %s n=%llu%s", std::string(entry.name).c_str(), (unsigned long long)count, line.c_str());
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "JavascriptApi.h"
+
+#include <json11/json11.hpp>
+
+// Lock-free latency histograms for every plugin JS API function, split by the stage a request is in
+class PerfStats
+{
+public:
+	enum Stage
+	{
+		// Waiting in a PluginJsHandler lane, including the wait on earlier mutations
+		STAGE_QUEUE = 0,
+
+		// Json::parse of the request params
+		STAGE_PARSE,
+
+		// Waiting for the Qt main thread to pick up runOnMainThread work
+		STAGE_HOP,
+
+		// The JS_* handler itself, hop time excluded
+		STAGE_HANDLER,
+
+		// Handing the result to the callback outbox, including any wait for room in it
+		STAGE_CALLBACK,
+
+		STAGE_COUNT,
+	};
+
+	void record(const JavascriptApi::JSFuncs funcId, const Stage stage, const uint64_t ns);
+
+	// { "funcname": { "queue": { "count": 1, "mean_us": 1.0, "p50_us": 1.0, "p90_us": 1.0, "p99_us": 1.0, "max_us": 1.0 }, ... }, ... }
+	json11::Json toJson() const;
+
+	// One line per function that has been called, skipped when nothing ran since the last summary
+	void logSummary();
+
+	// The request the calling thread is executing, so nested helpers can attribute their time to it
+	static void beginRequest(const JavascriptApi::JSFuncs funcId);
+	static JavascriptApi::JSFuncs currentRequest();
+	static void addHopTime(const uint64_t ns);
+	static uint64_t takeHopTime();
+
+	static uint64_t now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+public:
+	static PerfStats &instance()
+	{
+		static PerfStats a;
+		return a;
+	}
+
+private:
+	// Log-linear buckets, four per power of two, so any value lands within 25% of its bucket's bounds
+	static constexpr int kSubBucketBits = 2;
+	static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+	static constexpr int kMaxExponent = 36; // ~68 seconds, anything longer shares the last bucket
+	static constexpr int kBucketCount = (kMaxExponent - kSubBucketBits + 1) * kSubBucketCount + kSubBucketCount;
+
+	struct Histogram
+	{
+		std::atomic<uint64_t> buckets[kBucketCount] = {};
+		std::atomic<uint64_t> count = 0;
+		std::atomic<uint64_t> sumNs = 0;
+		std::atomic<uint64_t> maxNs = 0;
+	};
+
+	PerfStats() {}
+	~PerfStats() {}
+
+	static int bucketIndex(const uint64_t ns);
+	static uint64_t bucketUpperBound(const int index);
+	static double percentileUs(const Histogram &histogram, const uint64_t count, const double percentile);
+
+	Histogram m_histograms[JavascriptApi::JS_FUNCS_COUNT][STAGE_COUNT];
+	uint64_t m_lastSummaryCount = 0;
+};
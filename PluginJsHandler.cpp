@@ -7,6 +7,10 @@
 #include "WebServer.h"
 #include "WindowsFunctions.h"
 #include "SlDockEventFilter.h"
+#include "PerfStats.h"
+#include "JsArgBinder.h"
+#include "SourceQueryCache.h"
+#include "base64/base64.hpp"
 
 // Windows
 #include <ShlObj.h>
@@ -15,6 +19,7 @@
 
 // Stl
 #include <chrono>
+#include <algorithm>
 #include <functional>
 #include <codecvt>
 
@@ -33,9 +38,42 @@
 #include <QFontDatabase>
 #include <QApplication>
 #include <QProcess>
+#include <QThread>
 
 using namespace json11;
 
+namespace {
+
+// The page whose request is running on this thread, for handlers that send something back to it later
+thread_local int t_requestBrowserId = 0;
+
+// Only the components present are overwritten, { x: 10 } leaves y as it was
+void mergeVec2(const Json &json, vec2 &inout)
+{
+	if (json["x"].is_number())
+		inout.x = (float)json["x"].number_value();
+
+	if (json["y"].is_number())
+		inout.y = (float)json["y"].number_value();
+}
+
+// False if the file was truncated underneath the view and its pages are gone
+// Nothing in here needs unwinding, __try can't share a function with C++ objects that do
+bool copyFromView(char *dest, const char *view, const size_t length)
+{
+	__try
+	{
+		memcpy(dest, view, length);
+		return true;
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+}
+
+}
+
 PluginJsHandler::PluginJsHandler() {}
 
 PluginJsHandler::~PluginJsHandler()
@@ -85,53 +123,216 @@ QDockWidget* PluginJsHandler::findDock(const std::string &objectName)
 void PluginJsHandler::start()
 {
 	m_running = true;
-	m_workerThread = std::thread(&PluginJsHandler::workerThread, this);
+
+	// Mutations keep a single thread so they stay in order within a priority, reads and disk/network work can overlap
+	m_mutateLane.threads.emplace_back(&PluginJsHandler::workerThread, this, std::ref(m_mutateLane), JavascriptApi::JS_CLASS_MUTATE);
+
+	for (int i = 0; i < 4; ++i)
+		m_readLane.threads.emplace_back(&PluginJsHandler::workerThread, this, std::ref(m_readLane), JavascriptApi::JS_CLASS_READ);
+
+	for (int i = 0; i < 2; ++i)
+		m_ioLane.threads.emplace_back(&PluginJsHandler::workerThread, this, std::ref(m_ioLane), JavascriptApi::JS_CLASS_IO);
+
 	m_freezeCheckThread = std::thread(&PluginJsHandler::freezeCheckThread, this);
 }
 
 void PluginJsHandler::stop()
 {
-	m_running = false;
+	for (RequestLane *lane : {&m_mutateLane, &m_readLane, &m_ioLane})
+	{
+		// Flip under the lock so a worker can't miss the wakeup between its predicate check and wait
+		std::lock_guard<std::mutex> grd(lane->mtx);
+		m_running = false;
+	}
+
+	{
+		std::lock_guard<std::mutex> grd(m_mutationsMtx);
+		m_running = false;
+	}
 
-	if (m_workerThread.joinable())
-		m_workerThread.join();
+	m_mutationsCv.notify_all();
+
+	for (RequestLane *lane : {&m_mutateLane, &m_readLane, &m_ioLane})
+	{
+		lane->cv.notify_all();
+
+		for (auto &thread : lane->threads)
+		{
+			if (thread.joinable())
+				thread.join();
+		}
+
+		lane->threads.clear();
+	}
 
 	if (m_freezeCheckThread.joinable())
 		m_freezeCheckThread.join();
 }
 
-void PluginJsHandler::pushApiRequest(const std::string &funcName, const std::string &params)
+PluginJsHandler::RequestLane &PluginJsHandler::getLane(const JavascriptApi::JSFuncClass funcClass)
+{
+	switch (funcClass)
+	{
+	case JavascriptApi::JS_CLASS_READ:
+		return m_readLane;
+	case JavascriptApi::JS_CLASS_IO:
+		return m_ioLane;
+	default:
+		return m_mutateLane;
+	}
+}
+
+void PluginJsHandler::pushApiRequest(std::string funcName, std::string params, const int callbackId, const int requestedPriority, const int browserId, std::unique_ptr<TypedArgs> typedArgs)
 {
-	std::lock_guard<std::mutex> grd(m_queueMtx);
-	m_queudRequests.push_back({funcName, params});
+	const auto funcId = JavascriptApi::getFunctionId(funcName);
+	const auto funcClass = JavascriptApi::getFunctionClass(funcId);
+	RequestLane &lane = getLane(funcClass);
+
+	JavascriptApi::JSFuncPriority priority = JavascriptApi::getFunctionPriority(funcId);
+
+	// 0 on the wire keeps the function's default
+	if (requestedPriority > 0 && requestedPriority <= JavascriptApi::JS_PRIORITY_COUNT)
+		priority = JavascriptApi::JSFuncPriority(requestedPriority - 1);
+
+	// Mutations run strictly in the order they were sent, one can depend on the one before (add the item, then show it)
+	// A high one instead gets the main thread to itself sooner, reads and IO stop starting lesser work until it's done
+	const bool urgent = funcClass == JavascriptApi::JS_CLASS_MUTATE && priority == JavascriptApi::JS_PRIORITY_HIGH;
+
+	if (funcClass == JavascriptApi::JS_CLASS_MUTATE)
+		priority = JavascriptApi::JS_PRIORITY_NORMAL;
+
+	if (urgent)
+		++m_urgentMutations;
+
+	{
+		std::lock_guard<std::mutex> grd(lane.mtx);
+
+		uint64_t ticket = 0;
+
+		if (funcClass == JavascriptApi::JS_CLASS_MUTATE)
+			ticket = ++m_mutationsQueued;
+		else if (funcClass == JavascriptApi::JS_CLASS_READ)
+			ticket = m_mutationsQueued;
+
+		lane.queues[priority].push_back({std::move(funcName), std::move(params), ticket, urgent, callbackId, browserId, funcId, PerfStats::now(), std::move(typedArgs)});
+	}
+
+	lane.cv.notify_one();
 }
 
-void PluginJsHandler::workerThread()
+void PluginJsHandler::cancelApiRequests(const std::vector<int> &callbackIds)
+{
+	std::vector<uint64_t> cancelledMutations;
+	int cancelledUrgent = 0;
+	size_t cancelled = 0;
+
+	auto isCancelled = [&callbackIds](const ApiRequest &request) {
+		return request.callbackId > 0 && std::find(callbackIds.begin(), callbackIds.end(), request.callbackId) != callbackIds.end();
+	};
+
+	for (RequestLane *lane : {&m_mutateLane, &m_readLane, &m_ioLane})
+	{
+		std::lock_guard<std::mutex> grd(lane->mtx);
+
+		for (int priority = 0; priority < JavascriptApi::JS_PRIORITY_COUNT; ++priority)
+		{
+			auto &queue = lane->queues[priority];
+			auto first = std::stable_partition(queue.begin() + lane->heads[priority], queue.end(), [&isCancelled](const ApiRequest &request) { return !isCancelled(request); });
+
+			for (auto itr = first; itr != queue.end(); ++itr)
+			{
+				if (lane == &m_mutateLane)
+					cancelledMutations.push_back(itr->mutationTicket);
+
+				if (itr->urgent)
+					++cancelledUrgent;
+			}
+
+			cancelled += queue.end() - first;
+			queue.erase(first, queue.end());
+		}
+	}
+
+	// A dropped mutation still counts as done, otherwise reads queued behind it would wait forever
+	for (uint64_t ticket : cancelledMutations)
+		completeMutation(ticket);
+
+	while (cancelledUrgent-- > 0)
+		finishUrgentMutation();
+
+	if (cancelled > 0)
+		blog(LOG_INFO, "PluginJsHandler::cancelApiRequests dropped %d queued requests", int(cancelled));
+}
+
+bool PluginJsHandler::popApiRequest(RequestLane &lane, ApiRequest &out)
+{
+	// What's already running carries on, only new work waits for an urgent mutation
+	return lane.pop(out, [this] { return !m_running; }, [this, &lane] { return &lane != &m_mutateLane && m_urgentMutations > 0; });
+}
+
+void PluginJsHandler::completeMutation(const uint64_t ticket)
 {
-	while (m_running)
 	{
-		std::vector<std::pair<std::string, std::string>> latestBatch;
+		std::lock_guard<std::mutex> grd(m_mutationsMtx);
+		m_mutationsFinished.insert(ticket);
 
+		// Cancellation finishes mutations out of order, only advance over an unbroken run
+		while (!m_mutationsFinished.empty() && *m_mutationsFinished.begin() == m_mutationsDone + 1)
 		{
-			std::lock_guard<std::mutex> grd(m_queueMtx);
-			latestBatch.swap(m_queudRequests);
+			m_mutationsFinished.erase(m_mutationsFinished.begin());
+			++m_mutationsDone;
 		}
+	}
 
-		if (latestBatch.empty())
+	m_mutationsCv.notify_all();
+}
+
+void PluginJsHandler::finishUrgentMutation()
+{
+	if (--m_urgentMutations > 0)
+		return;
+
+	// Under each lane's lock, a worker between checking and waiting would otherwise miss this
+	for (RequestLane *lane : {&m_readLane, &m_ioLane})
+	{
 		{
-			using namespace std::chrono;
-			std::this_thread::sleep_for(1ms);
+			std::lock_guard<std::mutex> grd(lane->mtx);
 		}
-		else
+
+		lane->cv.notify_all();
+	}
+}
+
+void PluginJsHandler::workerThread(RequestLane &lane, const JavascriptApi::JSFuncClass funcClass)
+{
+	ApiRequest request;
+
+	while (popApiRequest(lane, request))
+	{
+		if (funcClass == JavascriptApi::JS_CLASS_READ)
 		{
-			for (auto &itr : latestBatch)
-				executeApiRequest(itr.first, itr.second);
+			std::unique_lock<std::mutex> lock(m_mutationsMtx);
+			m_mutationsCv.wait(lock, [this, &request] { return m_mutationsDone >= request.mutationTicket || !m_running; });
+
+			if (!m_running)
+				return;
 		}
+
+		PerfStats::instance().record(request.funcId, PerfStats::STAGE_QUEUE, PerfStats::now() - request.enqueuedNs);
+		executeApiRequest(request);
+
+		if (funcClass == JavascriptApi::JS_CLASS_MUTATE)
+			completeMutation(request.mutationTicket);
+
+		if (request.urgent)
+			finishUrgentMutation();
 	}
 }
 
 void PluginJsHandler::freezeCheckThread()
 {
+	int checks = 0;
+
 	while (m_running)
 	{
 		std::atomic<bool> threadActive = true;
@@ -166,29 +367,50 @@ void PluginJsHandler::freezeCheckThread()
 			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 		}
 
+		// Roughly once a minute
+		if (++checks % 6 == 0)
+			PerfStats::instance().logSummary();
+
 		// Check every 10 seconds
 		for (int i = 0; i < 10000 && m_running; ++i)
 			std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
 }
 
-void PluginJsHandler::executeApiRequest(const std::string &funcName, const std::string &params)
+void PluginJsHandler::executeApiRequest(const ApiRequest &request)
 {
-	std::string err;
-	Json jsonParams = Json::parse(params, err);
+	const std::string &funcName = request.funcName;
+	const std::string &params = request.params;
+	const auto funcId = request.funcId;
 
-	if (!err.empty())
-	{
-		blog(LOG_ERROR, "PluginJsHandler::executeApiRequest invalid params %s", params.c_str());
-		return;
-	}
+	Json jsonParams;
 
-	const auto &param1Value = jsonParams["param1"];
+	// The browser's own handle from the grpc message, param1 is still the renderer's id and means nothing here
+	const int callbackId = request.callbackId;
 
-	if (param1Value.is_null())
+	// Typed requests skip JSON entirely
+	if (!request.typedArgs)
 	{
-		blog(LOG_ERROR, "PluginJsHandler::executeApiRequest Error: 'param1' key not found. %s", params.c_str());
-		return;
+		const uint64_t parseStart = PerfStats::now();
+
+		std::string err;
+		jsonParams = Json::parse(params, err);
+
+		PerfStats::instance().record(funcId, PerfStats::STAGE_PARSE, PerfStats::now() - parseStart);
+
+		if (!err.empty())
+		{
+			blog(LOG_ERROR, "PluginJsHandler::executeApiRequest invalid params %s", params.c_str());
+			return;
+		}
+
+		const auto &param1Value = jsonParams["param1"];
+
+		if (param1Value.is_null())
+		{
+			blog(LOG_ERROR, "PluginJsHandler::executeApiRequest Error: 'param1' key not found. %s", params.c_str());
+			return;
+		}
 	}
 
 #ifndef GITHUB_REVISION
@@ -197,7 +419,36 @@ void PluginJsHandler::executeApiRequest(const std::string &funcName, const std::
 
 	std::string jsonReturnStr;
 
-	switch (JavascriptApi::getFunctionId(funcName)) {
+	t_requestBrowserId = request.browserId;
+	PerfStats::beginRequest(funcId);
+	const uint64_t handlerStart = PerfStats::now();
+
+	if (request.typedArgs)
+		dispatchTypedRequest(funcId, *request.typedArgs, jsonReturnStr);
+	else
+		dispatchApiRequest(funcId, jsonParams, jsonReturnStr);
+
+	// Time spent waiting on the main thread is reported as its own stage
+	PerfStats::instance().record(funcId, PerfStats::STAGE_HANDLER, PerfStats::now() - handlerStart - PerfStats::takeHopTime());
+	PerfStats::beginRequest(JavascriptApi::JS_INVALID);
+	t_requestBrowserId = 0;
+
+#ifndef GITHUB_REVISION
+	blog(LOG_INFO, "executeApiRequest (finish) %s: jsonReturnStr = %s\n", funcName.c_str(), jsonReturnStr.c_str());
+#endif
+
+	// We're done, send callback
+	if (callbackId > 0)
+	{
+		const uint64_t callbackStart = PerfStats::now();
+		GrpcPlugin::instance().getClient()->send_executeCallback(callbackId, std::move(jsonReturnStr));
+		PerfStats::instance().record(funcId, PerfStats::STAGE_CALLBACK, PerfStats::now() - callbackStart);
+	}
+}
+
+void PluginJsHandler::dispatchApiRequest(const JavascriptApi::JSFuncs funcId, const json11::Json &jsonParams, std::string &jsonReturnStr)
+{
+	switch (funcId) {
 		case JavascriptApi::JS_QUERY_DOCKS: JS_QUERY_DOCKS(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_DOCK_EXECUTEJAVASCRIPT: JS_DOCK_EXECUTEJAVASCRIPT(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_DOCK_SETURL: JS_DOCK_SETURL(jsonParams, jsonReturnStr); break;
@@ -247,6 +498,7 @@ void PluginJsHandler::executeApiRequest(const std::string &funcName, const std::
 		case JavascriptApi::JS_SET_SCENEITEM_BLENDING_MODE: JS_SET_SCENEITEM_BLENDING_MODE(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_SET_SCENEITEM_BLENDING_METHOD: JS_SET_SCENEITEM_BLENDING_METHOD(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_SET_SCALE: JS_SET_SCALE(jsonParams, jsonReturnStr); break;
+		case JavascriptApi::JS_COMMIT_SCENEITEM_TRANSFORMS: JS_COMMIT_SCENEITEM_TRANSFORMS(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_GET_SCENEITEM_POS: JS_GET_SCENEITEM_POS(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_GET_SCENEITEM_ROT: JS_GET_SCENEITEM_ROT(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_GET_SCENEITEM_CROP: JS_GET_SCENEITEM_CROP(jsonParams, jsonReturnStr); break;
@@ -274,16 +526,200 @@ void PluginJsHandler::executeApiRequest(const std::string &funcName, const std::
 		case JavascriptApi::JS_QT_INVOKE_CLICK_ON_STREAM_BUTTON: JS_QT_INVOKE_CLICK_ON_STREAM_BUTTON(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_SOURCE_FILTER_ADD: JS_SOURCE_FILTER_ADD(jsonParams, jsonReturnStr); break;
 		case JavascriptApi::JS_SOURCE_FILTER_REMOVE: JS_SOURCE_FILTER_REMOVE(jsonParams, jsonReturnStr); break;
+		case JavascriptApi::JS_BATCH: JS_BATCH(jsonParams, jsonReturnStr); break;
+		case JavascriptApi::JS_GET_PERF_STATS: JS_GET_PERF_STATS(jsonParams, jsonReturnStr); break;
 		default: jsonReturnStr = Json(Json::object{{"error", "Unknown Javascript Function"}}).dump(); break;
 	}
+}
 
-#ifndef GITHUB_REVISION
-	blog(LOG_INFO, "executeApiRequest (finish) %s: jsonReturnStr = %s\n", funcName.c_str(), jsonReturnStr.c_str());
-#endif
+void PluginJsHandler::dispatchTypedRequest(const JavascriptApi::JSFuncs funcId, const TypedArgs &args, std::string &out_jsonReturn)
+{
+	switch (funcId)
+	{
+		case JavascriptApi::JS_SET_SCENEITEM_POS: setSceneItemPos(args, out_jsonReturn); break;
+		case JavascriptApi::JS_SET_SCENEITEM_ROT: setSceneItemRot(args, out_jsonReturn); break;
+		case JavascriptApi::JS_SET_SCALE: setSceneItemScale(args, out_jsonReturn); break;
+		case JavascriptApi::JS_SET_SCENEITEM_CROP: setSceneItemCrop(args, out_jsonReturn); break;
+		case JavascriptApi::JS_GET_SCENEITEM_POS: getSceneItemPos(args, out_jsonReturn); break;
+		case JavascriptApi::JS_GET_SCENEITEM_ROT: getSceneItemRot(args, out_jsonReturn); break;
+		case JavascriptApi::JS_GET_SCALE: getSceneItemScale(args, out_jsonReturn); break;
+		case JavascriptApi::JS_GET_SCENEITEM_CROP: getSceneItemCrop(args, out_jsonReturn); break;
+
+		// These take no arguments, the JSON handlers never look at params
+		case JavascriptApi::JS_GET_CURRENT_SCENE: JS_GET_CURRENT_SCENE(Json(), out_jsonReturn); break;
+		case JavascriptApi::JS_GET_IS_OBS_STREAMING: JS_GET_IS_OBS_STREAMING(Json(), out_jsonReturn); break;
+
+		default:
+			out_jsonReturn = Json(Json::object({{"error", "Function has no typed form"}})).dump();
+			break;
+	}
+}
 
-	// We're done, send callback
-	if (param1Value.int_value() > 0)
-		GrpcPlugin::instance().getClient()->send_executeCallback(param1Value.int_value(), jsonReturnStr);
+void PluginJsHandler::runOnMainThread(const std::function<void()> &task)
+{
+	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+
+	// Handlers running inside a batch are already on the main thread, a blocking queued call to ourselves would deadlock
+	if (QThread::currentThread() == mainWindow->thread())
+	{
+		task();
+		return;
+	}
+
+	const uint64_t hopStart = PerfStats::now();
+	uint64_t hopNs = 0;
+
+	QMetaObject::invokeMethod(
+		mainWindow,
+		[&task, &hopNs, hopStart]() {
+			hopNs = PerfStats::now() - hopStart;
+			task();
+		},
+		Qt::BlockingQueuedConnection);
+
+	PerfStats::instance().record(PerfStats::currentRequest(), PerfStats::STAGE_HOP, hopNs);
+	PerfStats::addHopTime(hopNs);
+}
+
+/*static*/
+void PluginJsHandler::readSceneItem(const std::string &scene_name, const std::string &source_name, std::string &out_jsonReturn, const std::function<void(obs_sceneitem_t *)> &read)
+{
+	OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
+
+	if (!scene)
+	{
+		out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
+		return;
+	}
+
+	if (!obs_source_is_scene(scene))
+	{
+		out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();
+		return;
+	}
+
+	struct ItemRead
+	{
+		const std::string &source_name;
+		const std::function<void(obs_sceneitem_t *)> &read;
+		bool found = false;
+	} itemRead{source_name, read};
+
+	// Same match as obs_scene_find_source, but the scene's lock is held for the whole walk so the item can't be removed or freed mid-read
+	obs_scene_enum_items(
+		obs_scene_from_source(scene),
+		[](obs_scene_t *, obs_sceneitem_t *item, void *param) {
+			ItemRead &itemRead = *static_cast<ItemRead *>(param);
+			const char *name = obs_source_get_name(obs_sceneitem_get_source(item));
+
+			if (name == nullptr || itemRead.source_name != name)
+				return true;
+
+			itemRead.read(item);
+			itemRead.found = true;
+			return false;
+		},
+		&itemRead);
+
+	if (!itemRead.found)
+		out_jsonReturn = Json(Json::object({{"error", "Failed to find the source in that scene"}})).dump();
+}
+
+void PluginJsHandler::JS_GET_PERF_STATS(const json11::Json &params, std::string &out_jsonReturn)
+{
+	Json::object ipc;
+
+	if (auto client = GrpcPlugin::instance().getClient())
+		ipc["callback_outbox"] = client->getOutboxStats();
+
+	ipc["connection"] = GrpcPlugin::instance().getConnectionStats();
+
+	ipc["compression"] = GrpcPlugin::instance().getCompression().stats();
+
+	out_jsonReturn = Json(Json::object{{"functions", PerfStats::instance().toJson()}, {"ipc", ipc}}).dump();
+}
+
+void PluginJsHandler::JS_BATCH(const json11::Json &params, std::string &out_jsonReturn)
+{
+	const auto &param2Value = params["param2"];
+
+	std::string err;
+	Json jsonArray = param2Value.is_array() ? param2Value : Json::parse(param2Value.string_value(), err);
+
+	if (!err.empty() || !jsonArray.is_array())
+	{
+		out_jsonReturn = Json(Json::object({{"error", "Invalid parameter: " + err}})).dump();
+		return;
+	}
+
+	struct BatchCall
+	{
+		JavascriptApi::JSFuncs funcId = JavascriptApi::JS_INVALID;
+		Json params;
+		std::string result;
+	};
+
+	const auto &calls = jsonArray.array_items();
+	std::vector<BatchCall> batch(calls.size());
+
+	// Validate and build each call's params off the main thread, so the hop only pays for the OBS work
+	for (size_t i = 0; i < calls.size(); ++i)
+	{
+		BatchCall &call = batch[i];
+		const std::string &funcName = calls[i]["funcname"].string_value();
+
+		if (!JavascriptApi::isPluginFunctionName(funcName))
+		{
+			call.result = Json(Json::object({{"error", "Unknown Javascript Function " + funcName}})).dump();
+			continue;
+		}
+
+		call.funcId = JavascriptApi::getFunctionId(funcName);
+
+		if (!JavascriptApi::isBatchable(call.funcId))
+		{
+			call.result = Json(Json::object({{"error", "Function can not be batched " + funcName}})).dump();
+			call.funcId = JavascriptApi::JS_INVALID;
+			continue;
+		}
+
+		// Same layout executeApiRequest receives, param1 is the renderer's callback id and is unused here
+		Json::object callParams{{"param1", 0}};
+		const auto &args = calls[i]["params"].array_items();
+
+		for (size_t a = 0; a < args.size(); ++a)
+			callParams["param" + std::to_string(a + 2)] = args[a];
+
+		call.params = std::move(callParams);
+	}
+
+	// The calls run on the main thread, which doesn't know whose request this is
+	const int browserId = t_requestBrowserId;
+
+	runOnMainThread([this, &batch, browserId]() {
+		t_requestBrowserId = browserId;
+
+		for (auto &call : batch)
+		{
+			if (call.funcId != JavascriptApi::JS_INVALID)
+				dispatchApiRequest(call.funcId, call.params, call.result);
+		}
+
+		t_requestBrowserId = 0;
+	});
+
+	// Results are already serialized, splice them rather than parse and dump each again
+	out_jsonReturn = "[";
+
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		if (i > 0)
+			out_jsonReturn += ",";
+
+		out_jsonReturn += batch[i].result.empty() ? "{}" : batch[i].result;
+	}
+
+	out_jsonReturn += "]";
 }
 
 void PluginJsHandler::JS_START_WEBSERVER(const json11::Json &params, std::string &out_jsonReturn)
@@ -326,8 +762,7 @@ void PluginJsHandler::JS_LAUNCH_OS_BROWSER_URL(const json11::Json &params, std::
 
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, url, &out_jsonReturn]() {
 			mainWindow->setWindowState(mainWindow->windowState() & ~Qt::WindowMinimized);
 			mainWindow->show();
@@ -367,8 +802,7 @@ void PluginJsHandler::JS_LAUNCH_OS_BROWSER_URL(const json11::Json &params, std::
 
 			if (!ShellExecuteEx(&info))
 				out_jsonReturn = Json(Json::object{{"error", "Failed to open."}}).dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
 
 }
 
@@ -394,11 +828,8 @@ void PluginJsHandler::JS_SL_VERSION_INFO(const json11::Json &params, std::string
 
 void PluginJsHandler::JS_GET_STREAMSETTINGS(const json11::Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, &out_jsonReturn]() {
+	runOnMainThread(
+		[&out_jsonReturn]() {
 			obs_service_t *service_t = obs_frontend_get_streaming_service();
 
 			if (service_t)
@@ -419,14 +850,11 @@ void PluginJsHandler::JS_GET_STREAMSETTINGS(const json11::Json &params, std::str
 			{
 				out_jsonReturn = Json(Json::object({{"error", "No service exists"}})).dump();
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_STREAMSETTINGS(const json11::Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	const auto &param2Value = params["param2"];
 	const auto &param3Value = params["param3"];
 	const auto &param4Value = params["param4"];
@@ -444,9 +872,8 @@ void PluginJsHandler::JS_SET_STREAMSETTINGS(const json11::Json &params, std::str
 	std::string password = param7Value.string_value();
 	std::string key = param8Value.string_value();
 
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, &service, &protocol, &server, use_auth, &username, &password, &key, &out_jsonReturn]() {
+	runOnMainThread(
+		[&service, &protocol, &server, use_auth, &username, &password, &key, &out_jsonReturn]() {
 
 			obs_service_t *oldService = obs_frontend_get_streaming_service();
 			OBSDataAutoRelease hotkeyData = obs_hotkeys_save_service(oldService);
@@ -468,16 +895,14 @@ void PluginJsHandler::JS_SET_STREAMSETTINGS(const json11::Json &params, std::str
 
 			obs_frontend_set_streaming_service(newService);
 			obs_frontend_save_streaming_service();
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_QUERY_DOCKS(const Json &params, std::string &out_jsonReturn)
 {
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, &out_jsonReturn]() {
 			std::vector<Json> dockInfo;
 
@@ -520,8 +945,7 @@ void PluginJsHandler::JS_QUERY_DOCKS(const Json &params, std::string &out_jsonRe
 			// Convert the panelInfo vector to a Json object and dump string
 			Json ret = dockInfo;
 			out_jsonReturn = ret.dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_DOCK_SWAP(const Json &params, std::string &out_jsonReturn)
@@ -537,8 +961,7 @@ void PluginJsHandler::JS_DOCK_SWAP(const Json &params, std::string &out_jsonRetu
 
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, objectName1, objectName2, &out_jsonReturn]() {
 			QDockWidget *dock1 = nullptr;
 			QDockWidget *dock2 = nullptr;
@@ -566,8 +989,7 @@ void PluginJsHandler::JS_DOCK_SWAP(const Json &params, std::string &out_jsonRetu
 
 				out_jsonReturn = Json(Json::object{{"status", "success"}}).dump();
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_DOCK_RESIZE(const Json &params, std::string &out_jsonReturn)
@@ -583,19 +1005,15 @@ void PluginJsHandler::JS_DOCK_RESIZE(const Json &params, std::string &out_jsonRe
 	// An error for now, if we succeed this is overwritten
 	out_jsonReturn = Json(Json::object({{"error", "Did not find dock with objectName: " + objectName}})).dump();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, objectName, width, height, &out_jsonReturn]() {
+	runOnMainThread(
+		[objectName, width, height, &out_jsonReturn]() {
 
 			if (auto dock = findDock(objectName))
 			{
 				dock->resize(width, height);
 				out_jsonReturn = Json(Json::object{{"status", "success"}}).dump();
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_DOCK_SETAREA(const Json &params, std::string &out_jsonReturn)
@@ -611,8 +1029,7 @@ void PluginJsHandler::JS_DOCK_SETAREA(const Json &params, std::string &out_jsonR
 
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, objectName, areaMask, &out_jsonReturn]() {
 			// Find the panel by name (assuming the name is stored as a property)
 			QList<QDockWidget *> docks = mainWindow->findChildren<QDockWidget *>();
@@ -630,8 +1047,7 @@ void PluginJsHandler::JS_DOCK_SETAREA(const Json &params, std::string &out_jsonR
 					break;
 				}
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_DOCK_EXECUTEJAVASCRIPT(const Json &params, std::string &out_jsonReturn)
@@ -651,12 +1067,9 @@ void PluginJsHandler::JS_DOCK_EXECUTEJAVASCRIPT(const Json &params, std::string
 	// An error for now, if we succeed this is overwritten
 	out_jsonReturn = Json(Json::object({{"error", "Did not find dock with objectName: " + objectName}})).dump();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, javascriptcode, objectName, &out_jsonReturn]() {
+	runOnMainThread(
+		[javascriptcode, objectName, &out_jsonReturn]() {
 
 			if (auto dock = findDock(objectName))
 			{
@@ -674,8 +1087,7 @@ void PluginJsHandler::JS_DOCK_EXECUTEJAVASCRIPT(const Json &params, std::string
 					}
 				}
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_TOGGLE_USER_INPUT(const json11::Json &params, std::string &out_jsonReturn)
@@ -683,15 +1095,12 @@ void PluginJsHandler::JS_TOGGLE_USER_INPUT(const json11::Json &params, std::stri
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 	bool enable = params["param2"].bool_value();
 
-	QMetaObject::invokeMethod(
-		mainWindow, [mainWindow, enable]() { ::EnableWindow(reinterpret_cast<HWND>(mainWindow->winId()), enable); }, Qt::BlockingQueuedConnection);
+	runOnMainThread([mainWindow, enable]() { ::EnableWindow(reinterpret_cast<HWND>(mainWindow->winId()), enable); });
 }
 
 
 void PluginJsHandler::JS_DOCK_NEW_BROWSER_DOCK(const json11::Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	const auto &param2Value = params["param2"];
 	const auto &param3Value = params["param3"];
 	const auto &param4Value = params["param4"];
@@ -706,9 +1115,8 @@ void PluginJsHandler::JS_DOCK_NEW_BROWSER_DOCK(const json11::Json &params, std::
 		return;
 	}
 
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, objectName, title, url, &out_jsonReturn]() {
+	runOnMainThread(
+		[objectName, title, url, &out_jsonReturn]() {
 
 			// Check duplication
 			if (findDock(objectName))
@@ -738,18 +1146,15 @@ void PluginJsHandler::JS_DOCK_NEW_BROWSER_DOCK(const json11::Json &params, std::
 
 				//mainWindow->addDockWidget(Qt::LeftDockWidgetArea, dock);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_QT_INVOKE_CLICK_ON_STREAM_BUTTON(const Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 	out_jsonReturn = Json(Json::object{{"status", "failure"}}).dump();
 
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, &out_jsonReturn]() {
+	runOnMainThread(
+		[&out_jsonReturn]() {
 			if (QApplication::activeModalWidget())
 			{
 				out_jsonReturn = Json(Json::object{{"error", "activeModalWidget"}}).dump();
@@ -759,8 +1164,7 @@ void PluginJsHandler::JS_QT_INVOKE_CLICK_ON_STREAM_BUTTON(const Json &params, st
 				QtGuiModifications::instance().outsideInvokeClickStreamButton();
 				out_jsonReturn = Json(Json::object{{"status", "success"}}).dump();
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 
 }
 
@@ -769,7 +1173,8 @@ void PluginJsHandler::JS_QT_SET_JS_ON_CLICK_STREAM(const Json &params, std::stri
 	const auto &param2Value = params["param2"];
 	std::string jsstr = param2Value.string_value();
 
-	QtGuiModifications::instance().setJavascriptToCallOnStreamClick(jsstr);
+	// Runs in the page that set it, not whichever one happens to have called last
+	QtGuiModifications::instance().setJavascriptToCallOnStreamClick(jsstr, t_requestBrowserId);
 	out_jsonReturn = Json(Json::object{{"status", "success"}}).dump();
 }
 
@@ -777,16 +1182,14 @@ void PluginJsHandler::JS_GET_MAIN_WINDOW_GEOMETRY(const Json &params, std::strin
 {
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, &out_jsonReturn]() {
 			int x = mainWindow->geometry().x();
 			int y = mainWindow->geometry().y();
 			int width = mainWindow->width();
 			int height = mainWindow->height();
 			out_jsonReturn = Json(Json::object{{{"x", x}, {"y", y}, {"width", width}, {"height", height}}}).dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_DOCK_SETURL(const Json &params, std::string &out_jsonReturn)
@@ -806,12 +1209,9 @@ void PluginJsHandler::JS_DOCK_SETURL(const Json &params, std::string &out_jsonRe
 	// An error for now, if we succeed this is overwritten
 	out_jsonReturn = Json(Json::object({{"error", "Did not find dock with objectName: " + objectName}})).dump();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, url, objectName, &out_jsonReturn]() {
+	runOnMainThread(
+		[url, objectName, &out_jsonReturn]() {
 
 			if (auto dock = findDock(objectName))
 			{
@@ -822,8 +1222,7 @@ void PluginJsHandler::JS_DOCK_SETURL(const Json &params, std::string &out_jsonRe
 					out_jsonReturn = Json(Json::object{{"status", "success"}}).dump();
 				}
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_TOGGLE_DOCK_VISIBILITY(const Json &params, std::string &out_jsonReturn)
@@ -840,8 +1239,7 @@ void PluginJsHandler::JS_TOGGLE_DOCK_VISIBILITY(const Json &params, std::string
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, visible, objectName, &out_jsonReturn]() {
 			QList<QDockWidget *> docks = mainWindow->findChildren<QDockWidget *>();
 			foreach(QDockWidget * dock, docks)
@@ -853,8 +1251,7 @@ void PluginJsHandler::JS_TOGGLE_DOCK_VISIBILITY(const Json &params, std::string
 					break;
 				}
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_DOCK_SETTITLE(const json11::Json &params, std::string &out_jsonReturn)
@@ -871,8 +1268,7 @@ void PluginJsHandler::JS_DOCK_SETTITLE(const json11::Json &params, std::string &
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, newTitle, objectName, &out_jsonReturn]() {
 			QList<QDockWidget *> docks = mainWindow->findChildren<QDockWidget *>();
 			foreach(QDockWidget * dock, docks)
@@ -886,8 +1282,7 @@ void PluginJsHandler::JS_DOCK_SETTITLE(const json11::Json &params, std::string &
 					break;
 				}
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_DOCK_RENAME(const json11::Json &params, std::string &out_jsonReturn)
@@ -900,15 +1295,11 @@ void PluginJsHandler::JS_DESTROY_DOCK(const Json &params, std::string &out_jsonR
 	const auto &param2Value = params["param2"];
 	std::string objectName = param2Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, objectName, &out_jsonReturn]() {
+	runOnMainThread(
+		[objectName, &out_jsonReturn]() {
 			//obs_frontend_remove_dock(objectName.c_str());
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SOURCE_GET_SETTINGS(const json11::Json &params, std::string &out_jsonReturn)
@@ -916,12 +1307,9 @@ void PluginJsHandler::JS_SOURCE_GET_SETTINGS(const json11::Json &params, std::st
 	const auto &param2Value = params["param2"];
 	std::string sourceName = param2Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, sourceName, &out_jsonReturn]() {
+	runOnMainThread(
+		[sourceName, &out_jsonReturn]() {
 			OBSSourceAutoRelease existingSource = obs_get_source_by_name(sourceName.c_str());
 			if (existingSource == nullptr)
 			{
@@ -938,8 +1326,7 @@ void PluginJsHandler::JS_SOURCE_GET_SETTINGS(const json11::Json &params, std::st
 
 			out_jsonReturn = Json(obs_data_get_json(settingsSource)).dump();
 			obs_data_release(settingsSource);
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SOURCE_SET_SETTINGS(const json11::Json &params, std::string &out_jsonReturn)
@@ -947,14 +1334,11 @@ void PluginJsHandler::JS_SOURCE_SET_SETTINGS(const json11::Json &params, std::st
 	const auto &param2Value = params["param2"];
 	const auto &param3Value = params["param3"];
 	std::string sourceName = param2Value.string_value();
-	std::string settingsJson = param3Value.string_value();
-
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+	std::string settingsJson = param3Value.is_object() ? param3Value.dump() : param3Value.string_value();
 
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, sourceName, settingsJson, &out_jsonReturn]() {
+	runOnMainThread(
+		[sourceName, settingsJson, &out_jsonReturn]() {
 			OBSSourceAutoRelease existingSource = obs_get_source_by_name(sourceName.c_str());
 			if (existingSource == nullptr)
 			{
@@ -973,8 +1357,7 @@ void PluginJsHandler::JS_SOURCE_SET_SETTINGS(const json11::Json &params, std::st
 			obs_data_release(newSettings);
 
 			out_jsonReturn = Json(Json::object({{"success", true}})).dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_TRANSITION_GET_SETTINGS(const json11::Json &params, std::string &out_jsonReturn)
@@ -982,12 +1365,9 @@ void PluginJsHandler::JS_TRANSITION_GET_SETTINGS(const json11::Json &params, std
 	const auto &param2Value = params["param2"];
 	std::string sourceName = param2Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, sourceName, &out_jsonReturn]() {
+	runOnMainThread(
+		[sourceName, &out_jsonReturn]() {
 			obs_frontend_source_list transitions = {};
 			obs_frontend_get_transitions(&transitions);
 
@@ -1019,8 +1399,7 @@ void PluginJsHandler::JS_TRANSITION_GET_SETTINGS(const json11::Json &params, std
 
 			out_jsonReturn = Json(obs_data_get_json(settingsSource)).dump();
 			obs_data_release(settingsSource);
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_TRANSITION_SET_SETTINGS(const json11::Json &params, std::string &out_jsonReturn)
@@ -1028,14 +1407,11 @@ void PluginJsHandler::JS_TRANSITION_SET_SETTINGS(const json11::Json &params, std
 	const auto &param2Value = params["param2"];
 	const auto &param3Value = params["param3"];
 	std::string sourceName = param2Value.string_value();
-	std::string settingsJson = param3Value.string_value();
-
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+	std::string settingsJson = param3Value.is_object() ? param3Value.dump() : param3Value.string_value();
 
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, sourceName, settingsJson, &out_jsonReturn]() {
+	runOnMainThread(
+		[sourceName, settingsJson, &out_jsonReturn]() {
 			obs_frontend_source_list transitions = {};
 			obs_frontend_get_transitions(&transitions);
 
@@ -1069,8 +1445,7 @@ void PluginJsHandler::JS_TRANSITION_SET_SETTINGS(const json11::Json &params, std
 			obs_data_release(newSettings);
 
 			out_jsonReturn = Json(Json::object({{"success", true}})).dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_OBS_SET_CURRENT_TRANSITION(const json11::Json &params, std::string &out_jsonReturn)
@@ -1078,12 +1453,9 @@ void PluginJsHandler::JS_OBS_SET_CURRENT_TRANSITION(const json11::Json &params,
 	const auto &param2Value = params["param2"];
 	std::string sourceName = param2Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, sourceName, &out_jsonReturn]() {
+	runOnMainThread(
+		[sourceName, &out_jsonReturn]() {
 
 			obs_frontend_source_list transitions = {};
 			obs_frontend_get_transitions(&transitions);
@@ -1108,8 +1480,7 @@ void PluginJsHandler::JS_OBS_SET_CURRENT_TRANSITION(const json11::Json &params,
 			}
 
 			obs_frontend_set_current_transition(transition);
-		},
-		Qt::BlockingQueuedConnection);	
+		});
 }
 
 void PluginJsHandler::JS_SAVE_SL_BROWSER_DOCKS(const json11::Json& params, std::string& out_jsonReturn)
@@ -1130,10 +1501,8 @@ void PluginJsHandler::JS_SOURCE_FILTER_ADD(const json11::Json &params, std::stri
 	std::string sourceName = param2Value.string_value();
 	std::string filterName = param3Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(mainWindow, [mainWindow, sourceName, filterName, &out_jsonReturn]() {
+	runOnMainThread([sourceName, filterName, &out_jsonReturn]() {
 		OBSSourceAutoRelease source = obs_get_source_by_name(sourceName.c_str());
 
 		if (!source)
@@ -1162,10 +1531,8 @@ void PluginJsHandler::JS_SOURCE_FILTER_REMOVE(const json11::Json &params, std::s
 	std::string sourceName = param2Value.string_value();
 	std::string filterName = param3Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(mainWindow, [mainWindow, sourceName, filterName, &out_jsonReturn]() {
+	runOnMainThread([sourceName, filterName, &out_jsonReturn]() {
 		OBSSourceAutoRelease source = obs_get_source_by_name(sourceName.c_str());
 
 		if (!source)
@@ -1195,8 +1562,7 @@ void PluginJsHandler::JS_OBS_REMOVE_TRANSITION(const json11::Json &params, std::
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, sourceName, &out_jsonReturn]() {
 			obs_frontend_source_list transitions = {};
 			obs_frontend_get_transitions(&transitions);
@@ -1242,8 +1608,7 @@ void PluginJsHandler::JS_OBS_REMOVE_TRANSITION(const json11::Json &params, std::
 			}
 
 			out_jsonReturn = Json(Json::object({{"error", "Unable to find transitions widget"}})).dump();	
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_OBS_ADD_TRANSITION(const json11::Json& params, std::string& out_jsonReturn)
@@ -1256,8 +1621,7 @@ void PluginJsHandler::JS_OBS_ADD_TRANSITION(const json11::Json& params, std::str
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, id, sourceName, &out_jsonReturn]() {
 
 			obs_frontend_source_list transitions = {};
@@ -1322,8 +1686,7 @@ void PluginJsHandler::JS_OBS_ADD_TRANSITION(const json11::Json& params, std::str
 			}
 
 			out_jsonReturn = Json(Json::object({{"error", "Unable to find transitions widget"}})).dump();	
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_OBS_TOGGLE_HIDE_SELF(const json11::Json& params, std::string& out_jsonReturn)
@@ -1333,12 +1696,10 @@ void PluginJsHandler::JS_OBS_TOGGLE_HIDE_SELF(const json11::Json& params, std::s
 	bool boolval = param2Value.bool_value();
 	
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, boolval, &out_jsonReturn]() {
 			mainWindow->setHidden(boolval);
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_OBS_BRING_FRONT(const json11::Json& params, std::string& out_jsonReturn)
@@ -1360,12 +1721,9 @@ void PluginJsHandler::JS_OBS_BRING_FRONT(const json11::Json& params, std::string
 
 void PluginJsHandler::JS_GET_CURRENT_SCENE(const json11::Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, &out_jsonReturn]() {
+	runOnMainThread(
+		[&out_jsonReturn]() {
 			OBSSourceAutoRelease current_scene_source = obs_frontend_get_current_scene();
 
 			if (current_scene_source == nullptr)
@@ -1376,8 +1734,7 @@ void PluginJsHandler::JS_GET_CURRENT_SCENE(const json11::Json &params, std::stri
 
 			auto rawName = obs_source_get_name(current_scene_source);
 			out_jsonReturn = Json(Json::object({{"name", rawName ? rawName : ""}})).dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_CURRENT_SCENE(const json11::Json &params, std::string &out_jsonReturn)
@@ -1385,12 +1742,9 @@ void PluginJsHandler::JS_SET_CURRENT_SCENE(const json11::Json &params, std::stri
 	const auto &param2Value = params["param2"];
 	std::string scene_name = param2Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, scene_name, &out_jsonReturn]() {
+	runOnMainThread(
+		[scene_name, &out_jsonReturn]() {
 			OBSSourceAutoRelease source = obs_get_source_by_name(scene_name.c_str());
 			if (!source)
 				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();			
@@ -1398,8 +1752,7 @@ void PluginJsHandler::JS_SET_CURRENT_SCENE(const json11::Json &params, std::stri
 				out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();			
 			else
 				obs_frontend_set_current_scene(source);
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SCENE_ADD(const json11::Json& params, std::string& out_jsonReturn)
@@ -1416,12 +1769,9 @@ void PluginJsHandler::JS_SCENE_ADD(const json11::Json& params, std::string& out_
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, scene_name, source_name, &out_jsonReturn]() {
+	runOnMainThread(
+		[scene_name, source_name, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			OBSSourceAutoRelease source = obs_get_source_by_name(source_name.c_str());
 			if (!scene)
@@ -1444,8 +1794,7 @@ void PluginJsHandler::JS_SCENE_ADD(const json11::Json& params, std::string& out_
 				if (!scene_item)
 					out_jsonReturn = Json(Json::object({{"error", "Failed to add source to scene"}})).dump();
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SOURCE_GET_PROPERTIES(const json11::Json& params, std::string& out_jsonReturn)
@@ -1453,12 +1802,9 @@ void PluginJsHandler::JS_SOURCE_GET_PROPERTIES(const json11::Json& params, std::
 	const auto &param2Value = params["param2"];
 	std::string source_name = param2Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, source_name, &out_jsonReturn]() {
+	runOnMainThread(
+		[source_name, &out_jsonReturn]() {
 			OBSSourceAutoRelease existingSource = obs_get_source_by_name(source_name.c_str());
 
 			if (existingSource == nullptr)
@@ -1669,8 +2015,7 @@ void PluginJsHandler::JS_SOURCE_GET_PROPERTIES(const json11::Json& params, std::
 
 			Json output = jsonProperties;
 			out_jsonReturn = output.dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_CREATE_SCENE(const json11::Json &params, std::string &out_jsonReturn)
@@ -1684,12 +2029,9 @@ void PluginJsHandler::JS_CREATE_SCENE(const json11::Json &params, std::string &o
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, scene_name, &out_jsonReturn]() {
+	runOnMainThread(
+		[scene_name, &out_jsonReturn]() {
 			OBSSourceAutoRelease existing = obs_get_source_by_name(scene_name.c_str());
 
 			if (existing != nullptr)
@@ -1702,8 +2044,7 @@ void PluginJsHandler::JS_CREATE_SCENE(const json11::Json &params, std::string &o
 			if (!scene)
 				out_jsonReturn = Json(Json::object({{"error", "Failed to create scene."}})).dump();
 						
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_DOWNLOAD_ZIP(const Json &params, std::string &out_jsonReturn)
@@ -1875,9 +2216,17 @@ void PluginJsHandler::JS_INSTALL_FONT(const json11::Json& params, std::string& o
 void PluginJsHandler::JS_READ_FILE(const Json &params, std::string &out_jsonReturn)
 {
 	const auto &param2Value = params["param2"];
+	const auto &param3Value = params["param3"];
+	const auto &param4Value = params["param4"];
 
 	std::string filepath = param2Value.string_value();
-	std::string filecontents;
+
+	// Given an offset the bytes are read instead, without the size limit
+	if (param3Value.is_number())
+	{
+		readFileRange(filepath, uint64_t(std::max(param3Value.number_value(), 0.0)), uint64_t(std::max(param4Value.number_value(), 0.0)), out_jsonReturn);
+		return;
+	}
 
 	std::ifstream file(filepath, std::ios::binary | std::ios::ate);
 
@@ -1894,14 +2243,14 @@ void PluginJsHandler::JS_READ_FILE(const Json &params, std::string &out_jsonRetu
 			// Check if file size is 1MB or higher
 			if (fileSize >= 1048576)
 			{
-				ret = Json::object({{"error", "File size is 1MB or higher"}});
+				ret = Json::object({{"error", "File size is 1MB or higher, read it in chunks by passing an offset"}});
 			}
 			else
 			{
-				std::stringstream buffer;
-				buffer << file.rdbuf();
-				filecontents = buffer.str();
-				ret = Json::object({{"contents", filecontents}});
+				// Straight into the string the result is built from
+				std::string filecontents(size_t(fileSize), '\0');
+				file.read(&filecontents[0], fileSize);
+				ret = Json::object({{"contents", std::move(filecontents)}});
 			}
 		}
 		catch (...)
@@ -1917,6 +2266,108 @@ void PluginJsHandler::JS_READ_FILE(const Json &params, std::string &out_jsonRetu
 	out_jsonReturn = ret.dump();
 }
 
+/*static*/
+void PluginJsHandler::readFileRange(const std::string &filepath, const uint64_t offset, const uint64_t length, std::string &out_jsonReturn)
+{
+	auto windowsError = [&out_jsonReturn](const std::string &what) {
+		out_jsonReturn = Json(Json::object({{"error", what + ". Checking for windows errors: '" + std::to_string(GetLastError()) + "'"}})).dump();
+	};
+
+	std::wstring wpath;
+
+	try
+	{
+		std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
+		wpath = myconv.from_bytes(filepath);
+	}
+	catch (const std::range_error &)
+	{
+		out_jsonReturn = Json(Json::object({{"error", "Invalid path: " + filepath}})).dump();
+		return;
+	}
+
+	// Write sharing so files still being written (obs's own logs) can be read, see copyFromView for one that shrinks meanwhile
+	HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		windowsError("Unable to open file");
+		return;
+	}
+
+	LARGE_INTEGER fileSize = {};
+
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		windowsError("Unable to read file size");
+		CloseHandle(file);
+		return;
+	}
+
+	const uint64_t size = uint64_t(fileSize.QuadPart);
+
+	if (offset > size)
+	{
+		out_jsonReturn = Json(Json::object({{"error", "Offset is past the end of the file"}})).dump();
+		CloseHandle(file);
+		return;
+	}
+
+	// 0 means as much as one chunk holds, and nothing past the size seen here even if the file grows meanwhile
+	const uint64_t chunk = std::min(length == 0 ? kMaxReadFileChunk : std::min(length, kMaxReadFileChunk), size - offset);
+	std::string data;
+
+	// An empty file can't be mapped, and there's nothing left to read past the end anyway
+	if (chunk > 0)
+	{
+		HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mapping == NULL)
+		{
+			windowsError("Unable to map file");
+			CloseHandle(file);
+			return;
+		}
+
+		// Views have to start on the allocation granularity
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+
+		const uint64_t viewOffset = offset - offset % systemInfo.dwAllocationGranularity;
+		const size_t skip = size_t(offset - viewOffset);
+
+		const char *view = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, DWORD(viewOffset >> 32), DWORD(viewOffset & 0xFFFFFFFF), skip + size_t(chunk)));
+
+		if (view == nullptr)
+		{
+			windowsError("Unable to map file");
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return;
+		}
+
+		std::string bytes(size_t(chunk), '\0');
+		const bool copied = copyFromView(&bytes[0], view + skip, size_t(chunk));
+
+		UnmapViewOfFile(view);
+		CloseHandle(mapping);
+
+		if (!copied)
+		{
+			out_jsonReturn = Json(Json::object({{"error", "File was truncated while it was being read"}})).dump();
+			CloseHandle(file);
+			return;
+		}
+
+		// Callbacks carry json, the bytes cross as base64 and the page receives an ArrayBuffer
+		data = base64_encode(bytes.data(), unsigned(chunk));
+	}
+
+	CloseHandle(file);
+
+	out_jsonReturn = Json(Json::object({{"offset", double(offset)}, {"length", double(chunk)}, {"size", double(size)}, {"eof", offset + chunk >= size}, {"data", std::move(data)}})).dump();
+}
+
 void PluginJsHandler::JS_DELETE_FILES(const Json &params, std::string &out_jsonReturn)
 {
 	Json ret;
@@ -1926,9 +2377,9 @@ void PluginJsHandler::JS_DELETE_FILES(const Json &params, std::string &out_jsonR
 	const auto &param2Value = params["param2"];
 
 	std::string err;
-	Json jsonArray = Json::parse(params["param2"].string_value().c_str(), err);
+	Json jsonArray = param2Value.is_array() ? param2Value : Json::parse(param2Value.string_value(), err);
 
-	if (!err.empty())
+	if (!err.empty() || !jsonArray.is_array())
 	{
 		out_jsonReturn = Json(Json::object({{"error", "Invalid parameter: " + err}})).dump();
 		return;
@@ -2133,16 +2584,14 @@ void PluginJsHandler::JS_QUERY_DOWNLOADS_FOLDER(const Json &params, std::string
 
 void PluginJsHandler::JS_OBS_SOURCE_CREATE(const Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, this, &params, &out_jsonReturn]() {
+	runOnMainThread(
+		[this, &params, &out_jsonReturn]() {
 			const auto &id = params["param2"].string_value();
 			const auto &name = params["param3"].string_value();
-			const auto &settings_jsonStr = params["param4"].string_value();
-			const auto &hotkey_data_jsonStr = params["param5"].string_value();
+			// Objects straight from the page, or the same as json strings
+			const std::string settings_jsonStr = params["param4"].is_object() ? params["param4"].dump() : params["param4"].string_value();
+			const std::string hotkey_data_jsonStr = params["param5"].is_object() ? params["param5"].dump() : params["param5"].string_value();
 
 			// Name is also the guid, duplicates can't exist
 			//	see "bool AddNew(QWidget *parent, const char *id, const char *name," in obs gui code
@@ -2199,18 +2648,14 @@ void PluginJsHandler::JS_OBS_SOURCE_CREATE(const Json &params, std::string &out_
 				out_jsonReturn = Json(Json::object({{"error", "Failed to add source to scene"}})).dump();
 
 			obs_source_release(source);
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_OBS_SOURCE_DESTROY(const Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, this, params, &out_jsonReturn]() {
+	runOnMainThread(
+		[this, params, &out_jsonReturn]() {
 			const auto &name = params["param2"].string_value();
 
 			OBSSourceAutoRelease src = obs_get_source_by_name(name.c_str());
@@ -2278,12 +2723,15 @@ void PluginJsHandler::JS_OBS_SOURCE_DESTROY(const Json &params, std::string &out
 			{
 				obs_source_remove(src);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_GET_SCENE_COLLECTIONS(const json11::Json& params, std::string& out_jsonReturn)
 {
+	if (SourceQueryCache::instance().get("scene_collections", out_jsonReturn))
+		return;
+
+	const uint64_t generation = SourceQueryCache::instance().generation();
 	char **scene_collections = obs_frontend_get_scene_collections();
 
 	std::vector<Json> result;
@@ -2291,9 +2739,13 @@ void PluginJsHandler::JS_GET_SCENE_COLLECTIONS(const json11::Json& params, std::
 	for (int i = 0; scene_collections[i] != nullptr; ++i)
 		result.push_back(Json::object{{"name", scene_collections[i]}});
 
+	bfree(scene_collections);
+
 	// Convert the panelInfo vector to a Json object and dump string
 	Json ret = result;
 	out_jsonReturn = ret.dump();
+
+	SourceQueryCache::instance().put("scene_collections", generation, out_jsonReturn);
 }
 
 void PluginJsHandler::JS_GET_CURRENT_SCENE_COLLECTION(const json11::Json &params, std::string &out_jsonReturn)
@@ -2333,15 +2785,20 @@ void PluginJsHandler::JS_ADD_SCENE_COLLECTION(const json11::Json &params, std::s
 
 void PluginJsHandler::JS_SET_SCENEITEM_POS(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-	const auto &param4Value = params["param4"];
-	const auto &param5Value = params["param5"];
+	TypedArgs args;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
-	float x = (float)param4Value.number_value();
-	float y = (float)param5Value.number_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, args.scene_name, args.source_name, args.pos.x, args.pos.y))
+		return;
+
+	setSceneItemPos(args, out_jsonReturn);
+}
+
+void PluginJsHandler::setSceneItemPos(const TypedArgs &args, std::string &out_jsonReturn)
+{
+	const std::string &scene_name = args.scene_name;
+	const std::string &source_name = args.source_name;
+	const float x = args.pos.x;
+	const float y = args.pos.y;
 
 	if (scene_name == source_name)
 	{
@@ -2349,12 +2806,9 @@ void PluginJsHandler::JS_SET_SCENEITEM_POS(const json11::Json &params, std::stri
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[mainWindow, scene_name, source_name, x, y, &out_jsonReturn]() {
+	runOnMainThread(
+		[scene_name, source_name, x, y, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
 				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
@@ -2376,19 +2830,17 @@ void PluginJsHandler::JS_SET_SCENEITEM_POS(const json11::Json &params, std::stri
 				pos.y = y;
 				obs_sceneitem_set_pos(scene_item, &pos);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_SCENEITEM_VISIBILITY(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-	const auto &param4Value = params["param4"];
+	std::string scene_name;
+	std::string source_name;
+	bool is_visible = false;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
-	const bool is_visible = param4Value.bool_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, scene_name, source_name, is_visible))
+		return;
 
 	if (scene_name == source_name)
 	{
@@ -2396,11 +2848,8 @@ void PluginJsHandler::JS_SET_SCENEITEM_VISIBILITY(const json11::Json &params, st
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[scene_name, source_name, is_visible, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
@@ -2420,19 +2869,24 @@ void PluginJsHandler::JS_SET_SCENEITEM_VISIBILITY(const json11::Json &params, st
 
 				obs_sceneitem_set_visible(scene_item, is_visible);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_SCENEITEM_ROT(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-	const auto &param4Value = params["param4"];
+	TypedArgs args;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
-	float rotation = (float)param4Value.number_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, args.scene_name, args.source_name, args.rotation))
+		return;
+
+	setSceneItemRot(args, out_jsonReturn);
+}
+
+void PluginJsHandler::setSceneItemRot(const TypedArgs &args, std::string &out_jsonReturn)
+{
+	const std::string &scene_name = args.scene_name;
+	const std::string &source_name = args.source_name;
+	const float rotation = args.rotation;
 
 	if (scene_name == source_name)
 	{
@@ -2440,11 +2894,8 @@ void PluginJsHandler::JS_SET_SCENEITEM_ROT(const json11::Json &params, std::stri
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[scene_name, source_name, rotation, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
@@ -2464,25 +2915,27 @@ void PluginJsHandler::JS_SET_SCENEITEM_ROT(const json11::Json &params, std::stri
 
 				obs_sceneitem_set_rot(scene_item, rotation);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_SCENEITEM_CROP(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-	const auto &param4Value = params["param4"];
-	const auto &param5Value = params["param5"];
-	const auto &param6Value = params["param6"];
-	const auto &param7Value = params["param7"];
+	TypedArgs args;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
-	int left = param4Value.int_value();
-	int top = param5Value.int_value();
-	int right = param6Value.int_value();
-	int bottom = param7Value.int_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, args.scene_name, args.source_name, args.crop.left, args.crop.top, args.crop.right, args.crop.bottom))
+		return;
+
+	setSceneItemCrop(args, out_jsonReturn);
+}
+
+void PluginJsHandler::setSceneItemCrop(const TypedArgs &args, std::string &out_jsonReturn)
+{
+	const std::string &scene_name = args.scene_name;
+	const std::string &source_name = args.source_name;
+	const int left = args.crop.left;
+	const int top = args.crop.top;
+	const int right = args.crop.right;
+	const int bottom = args.crop.bottom;
 
 	if (scene_name == source_name)
 	{
@@ -2490,11 +2943,8 @@ void PluginJsHandler::JS_SET_SCENEITEM_CROP(const json11::Json &params, std::str
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[scene_name, source_name, left, top, right, bottom, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
@@ -2515,19 +2965,17 @@ void PluginJsHandler::JS_SET_SCENEITEM_CROP(const json11::Json &params, std::str
 				struct obs_sceneitem_crop crop = {left, top, right, bottom};
 				obs_sceneitem_set_crop(scene_item, &crop);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_SCENEITEM_SCALE_FILTER(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-	const auto &param4Value = params["param4"];
+	std::string scene_name;
+	std::string source_name;
+	int scale_type = 0;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
-	int scale_type = param4Value.int_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, scene_name, source_name, scale_type))
+		return;
 
 	if (scene_name == source_name)
 	{
@@ -2535,11 +2983,8 @@ void PluginJsHandler::JS_SET_SCENEITEM_SCALE_FILTER(const json11::Json &params,
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[scene_name, source_name, scale_type, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
@@ -2559,19 +3004,17 @@ void PluginJsHandler::JS_SET_SCENEITEM_SCALE_FILTER(const json11::Json &params,
 
 				obs_sceneitem_set_scale_filter(scene_item, (obs_scale_type)scale_type);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_SCENEITEM_BLENDING_MODE(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-	const auto &param4Value = params["param4"];
+	std::string scene_name;
+	std::string source_name;
+	int blending_type = 0;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
-	int blending_type = param4Value.int_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, scene_name, source_name, blending_type))
+		return;
 
 	if (scene_name == source_name)
 	{
@@ -2579,11 +3022,8 @@ void PluginJsHandler::JS_SET_SCENEITEM_BLENDING_MODE(const json11::Json &params,
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[scene_name, source_name, blending_type, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
@@ -2603,19 +3043,17 @@ void PluginJsHandler::JS_SET_SCENEITEM_BLENDING_MODE(const json11::Json &params,
 
 				obs_sceneitem_set_blending_mode(scene_item, (obs_blending_type)blending_type);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_SCENEITEM_BLENDING_METHOD(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-	const auto &param4Value = params["param4"];
+	std::string scene_name;
+	std::string source_name;
+	int blending_method = 0;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
-	int blending_method = param4Value.int_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, scene_name, source_name, blending_method))
+		return;
 
 	if (scene_name == source_name)
 	{
@@ -2623,11 +3061,8 @@ void PluginJsHandler::JS_SET_SCENEITEM_BLENDING_METHOD(const json11::Json &param
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[scene_name, source_name, blending_method, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
@@ -2648,21 +3083,25 @@ void PluginJsHandler::JS_SET_SCENEITEM_BLENDING_METHOD(const json11::Json &param
 				// Assuming obs_sceneitem_set_blending_method exists and accepts an enum type for blending method.
 				obs_sceneitem_set_blending_method(scene_item, (obs_blending_method)blending_method);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 void PluginJsHandler::JS_SET_SCALE(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-	const auto &param4Value = params["param4"];
-	const auto &param5Value = params["param5"];
+	TypedArgs args;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
-	float x_scale = (float)param4Value.number_value();
-	float y_scale = (float)param5Value.number_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, args.scene_name, args.source_name, args.scale.x, args.scale.y))
+		return;
+
+	setSceneItemScale(args, out_jsonReturn);
+}
+
+void PluginJsHandler::setSceneItemScale(const TypedArgs &args, std::string &out_jsonReturn)
+{
+	const std::string &scene_name = args.scene_name;
+	const std::string &source_name = args.source_name;
+	const float x_scale = args.scale.x;
+	const float y_scale = args.scale.y;
 
 	if (scene_name == source_name)
 	{
@@ -2670,11 +3109,8 @@ void PluginJsHandler::JS_SET_SCALE(const json11::Json &params, std::string &out_
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[scene_name, source_name, x_scale, y_scale, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
@@ -2696,62 +3132,184 @@ void PluginJsHandler::JS_SET_SCALE(const json11::Json &params, std::string &out_
 				vec2 scale = {x_scale, y_scale};
 				obs_sceneitem_set_scale(scene_item, &scale);
 			}
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
-void PluginJsHandler::JS_GET_SCENEITEM_POS(const json11::Json &params, std::string &out_jsonReturn)
+void PluginJsHandler::JS_COMMIT_SCENEITEM_TRANSFORMS(const json11::Json &params, std::string &out_jsonReturn)
 {
 	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
+	std::string err;
+	Json jsonArray = param2Value.is_array() ? param2Value : Json::parse(param2Value.string_value(), err);
 
-	if (scene_name == source_name)
+	if (!err.empty() || !jsonArray.is_array())
 	{
-		out_jsonReturn = Json(Json::object({{"error", "Scene and source inputs have same name"}})).dump();
+		out_jsonReturn = Json(Json::object({{"error", "Invalid parameter: " + err}})).dump();
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+	struct TransformCommit
+	{
+		const std::vector<Json> *transforms = nullptr;
+		const std::vector<size_t> *indices = nullptr;
+		std::vector<std::string> *results = nullptr;
+	};
+
+	const auto &transforms = jsonArray.array_items();
+	std::vector<std::string> results(transforms.size());
+
+	// Group by scene in first seen order, each scene is then updated under a single lock
+	std::vector<std::pair<std::string, std::vector<size_t>>> sceneGroups;
+
+	for (size_t i = 0; i < transforms.size(); ++i)
+	{
+		const std::string &scene_name = transforms[i]["scene"].string_value();
+
+		if (scene_name == transforms[i]["source"].string_value())
+		{
+			results[i] = Json(Json::object({{"error", "Scene and source inputs have same name"}})).dump();
+			continue;
+		}
+
+		auto itr = std::find_if(sceneGroups.begin(), sceneGroups.end(), [&scene_name](const auto &group) { return group.first == scene_name; });
+
+		if (itr == sceneGroups.end())
+			sceneGroups.push_back({scene_name, {i}});
+		else
+			itr->second.push_back(i);
+	}
 
 	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[scene_name, source_name, &out_jsonReturn]() {
-			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
-			if (!scene)
-				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
-			else if (!obs_source_is_scene(scene))
-				out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();
-			else
+	runOnMainThread([&transforms, &sceneGroups, &results]() {
+		for (const auto &group : sceneGroups)
+		{
+			OBSSourceAutoRelease scene = obs_get_source_by_name(group.first.c_str());
+
+			if (!scene || !obs_source_is_scene(scene))
 			{
-				obs_scene_t *scene_obj = obs_scene_from_source(scene);
-				obs_sceneitem_t *scene_item = obs_scene_find_source(scene_obj, source_name.c_str());
+				const std::string error = Json(Json::object({{"error", "Did not find a scene with name " + group.first}})).dump();
 
-				if (!scene_item)
-				{
-					out_jsonReturn = Json(Json::object({{"error", "Failed to find the source in that scene"}})).dump();
-					return;
-				}
+				for (size_t i : group.second)
+					results[i] = error;
 
-				// Assuming obs_sceneitem_get_pos exists and retrieves x and y position values.
-				vec2 position;
-				obs_sceneitem_get_pos(scene_item, &position);
-				out_jsonReturn = Json(Json::object({{"x", position.x}, {"y", position.y}})).dump();
+				continue;
 			}
-		},
-		Qt::BlockingQueuedConnection);
+
+			TransformCommit commit{&transforms, &group.second, &results};
+
+			// The compositor sees every item of this scene change in the same frame, and each item recalculates its transform once
+			obs_scene_atomic_update(
+				obs_scene_from_source(scene),
+				[](void *data, obs_scene_t *scene_obj) {
+					TransformCommit &commit = *static_cast<TransformCommit *>(data);
+
+					for (size_t i : *commit.indices)
+					{
+						const Json &transform = (*commit.transforms)[i];
+						obs_sceneitem_t *scene_item = obs_scene_find_source(scene_obj, transform["source"].string_value().c_str());
+
+						if (!scene_item)
+						{
+							(*commit.results)[i] = Json(Json::object({{"error", "Failed find the source in that scene"}})).dump();
+							continue;
+						}
+
+						obs_sceneitem_defer_update_begin(scene_item);
+
+						// Partial objects start from the item's current values
+						if (transform["pos"].is_object())
+						{
+							vec2 pos;
+							obs_sceneitem_get_pos(scene_item, &pos);
+							mergeVec2(transform["pos"], pos);
+							obs_sceneitem_set_pos(scene_item, &pos);
+						}
+
+						if (transform["rot"].is_number())
+							obs_sceneitem_set_rot(scene_item, (float)transform["rot"].number_value());
+
+						if (transform["scale"].is_object())
+						{
+							vec2 scale;
+							obs_sceneitem_get_scale(scene_item, &scale);
+							mergeVec2(transform["scale"], scale);
+							obs_sceneitem_set_scale(scene_item, &scale);
+						}
+
+						if (transform["crop"].is_object())
+						{
+							const Json &cropJson = transform["crop"];
+							struct obs_sceneitem_crop crop;
+							obs_sceneitem_get_crop(scene_item, &crop);
+
+							if (cropJson["left"].is_number())
+								crop.left = cropJson["left"].int_value();
+							if (cropJson["top"].is_number())
+								crop.top = cropJson["top"].int_value();
+							if (cropJson["right"].is_number())
+								crop.right = cropJson["right"].int_value();
+							if (cropJson["bottom"].is_number())
+								crop.bottom = cropJson["bottom"].int_value();
+
+							obs_sceneitem_set_crop(scene_item, &crop);
+						}
+
+						if (transform["alignment"].is_number())
+							obs_sceneitem_set_alignment(scene_item, (uint32_t)transform["alignment"].int_value());
+
+						if (transform["bounds"].is_object())
+						{
+							const Json &boundsJson = transform["bounds"];
+
+							if (boundsJson["type"].is_number())
+								obs_sceneitem_set_bounds_type(scene_item, (obs_bounds_type)boundsJson["type"].int_value());
+
+							if (boundsJson["alignment"].is_number())
+								obs_sceneitem_set_bounds_alignment(scene_item, (uint32_t)boundsJson["alignment"].int_value());
+
+							if (boundsJson["x"].is_number() || boundsJson["y"].is_number())
+							{
+								vec2 bounds;
+								obs_sceneitem_get_bounds(scene_item, &bounds);
+								mergeVec2(boundsJson, bounds);
+								obs_sceneitem_set_bounds(scene_item, &bounds);
+							}
+						}
+
+						obs_sceneitem_defer_update_end(scene_item);
+					}
+				},
+				&commit);
+		}
+	});
+
+	out_jsonReturn = "[";
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		if (i > 0)
+			out_jsonReturn += ",";
+
+		out_jsonReturn += results[i].empty() ? "{}" : results[i];
+	}
+
+	out_jsonReturn += "]";
 }
 
-void PluginJsHandler::JS_GET_SCENEITEM_ROT(const json11::Json &params, std::string &out_jsonReturn)
+void PluginJsHandler::JS_GET_SCENEITEM_POS(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
+	TypedArgs args;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, args.scene_name, args.source_name))
+		return;
+
+	getSceneItemPos(args, out_jsonReturn);
+}
+
+void PluginJsHandler::getSceneItemPos(const TypedArgs &args, std::string &out_jsonReturn)
+{
+	const std::string &scene_name = args.scene_name;
+	const std::string &source_name = args.source_name;
 
 	if (scene_name == source_name)
 	{
@@ -2759,43 +3317,28 @@ void PluginJsHandler::JS_GET_SCENEITEM_ROT(const json11::Json &params, std::stri
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+	readSceneItem(scene_name, source_name, out_jsonReturn, [&out_jsonReturn](obs_sceneitem_t *scene_item) {
+		// Assuming obs_sceneitem_get_pos exists and retrieves x and y position values.
+		vec2 position;
+		obs_sceneitem_get_pos(scene_item, &position);
+		out_jsonReturn = Json(Json::object({{"x", position.x}, {"y", position.y}})).dump();
+	});
+}
 
-	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[scene_name, source_name, &out_jsonReturn]() {
-			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
-			if (!scene)
-				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
-			else if (!obs_source_is_scene(scene))
-				out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();
-			else
-			{
-				obs_scene_t *scene_obj = obs_scene_from_source(scene);
-				obs_sceneitem_t *scene_item = obs_scene_find_source(scene_obj, source_name.c_str());
+void PluginJsHandler::JS_GET_SCENEITEM_ROT(const json11::Json &params, std::string &out_jsonReturn)
+{
+	TypedArgs args;
 
-				if (!scene_item)
-				{
-					out_jsonReturn = Json(Json::object({{"error", "Failed to find the source in that scene"}})).dump();
-					return;
-				}
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, args.scene_name, args.source_name))
+		return;
 
-				// Assuming obs_sceneitem_get_rot exists and retrieves the rotation value.
-				float rotation = obs_sceneitem_get_rot(scene_item);
-				out_jsonReturn = Json(Json::object({{"rotation", rotation}})).dump();
-			}
-		},
-		Qt::BlockingQueuedConnection);
+	getSceneItemRot(args, out_jsonReturn);
 }
 
-void PluginJsHandler::JS_GET_SCENEITEM_CROP(const json11::Json &params, std::string &out_jsonReturn)
+void PluginJsHandler::getSceneItemRot(const TypedArgs &args, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
-
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
+	const std::string &scene_name = args.scene_name;
+	const std::string &source_name = args.source_name;
 
 	if (scene_name == source_name)
 	{
@@ -2803,36 +3346,41 @@ void PluginJsHandler::JS_GET_SCENEITEM_CROP(const json11::Json &params, std::str
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+	readSceneItem(scene_name, source_name, out_jsonReturn, [&out_jsonReturn](obs_sceneitem_t *scene_item) {
+		// Assuming obs_sceneitem_get_rot exists and retrieves the rotation value.
+		float rotation = obs_sceneitem_get_rot(scene_item);
+		out_jsonReturn = Json(Json::object({{"rotation", rotation}})).dump();
+	});
+}
 
-	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[scene_name, source_name, &out_jsonReturn]() {
-			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
-			if (!scene)
-				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
-			else if (!obs_source_is_scene(scene))
-				out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();
-			else
-			{
-				obs_scene_t *scene_obj = obs_scene_from_source(scene);
-				obs_sceneitem_t *scene_item = obs_scene_find_source(scene_obj, source_name.c_str());
+void PluginJsHandler::JS_GET_SCENEITEM_CROP(const json11::Json &params, std::string &out_jsonReturn)
+{
+	TypedArgs args;
 
-				if (!scene_item)
-				{
-					out_jsonReturn = Json(Json::object({{"error", "Failed to find the source in that scene"}})).dump();
-					return;
-				}
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, args.scene_name, args.source_name))
+		return;
 
-				// Assuming obs_sceneitem_get_crop exists and retrieves the crop values.
-				obs_sceneitem_crop crop_values;
-				obs_sceneitem_get_crop(scene_item, &crop_values);
+	getSceneItemCrop(args, out_jsonReturn);
+}
 
-				out_jsonReturn = Json(Json::object({{"left", crop_values.left}, {"right", crop_values.right}, {"top", crop_values.top}, {"bottom", crop_values.bottom}})).dump();
-			}
-		},
-		Qt::BlockingQueuedConnection);
+void PluginJsHandler::getSceneItemCrop(const TypedArgs &args, std::string &out_jsonReturn)
+{
+	const std::string &scene_name = args.scene_name;
+	const std::string &source_name = args.source_name;
+
+	if (scene_name == source_name)
+	{
+		out_jsonReturn = Json(Json::object({{"error", "Scene and source inputs have same name"}})).dump();
+		return;
+	}
+
+	readSceneItem(scene_name, source_name, out_jsonReturn, [&out_jsonReturn](obs_sceneitem_t *scene_item) {
+		// Assuming obs_sceneitem_get_crop exists and retrieves the crop values.
+		obs_sceneitem_crop crop_values;
+		obs_sceneitem_get_crop(scene_item, &crop_values);
+
+		out_jsonReturn = Json(Json::object({{"left", crop_values.left}, {"right", crop_values.right}, {"top", crop_values.top}, {"bottom", crop_values.bottom}})).dump();
+	});
 }
 
 void PluginJsHandler::JS_GET_SOURCE_DIMENSIONS(const json11::Json &params, std::string &out_jsonReturn)
@@ -2840,34 +3388,35 @@ void PluginJsHandler::JS_GET_SOURCE_DIMENSIONS(const json11::Json &params, std::
 	const auto &param2Value = params["param2"];
 	std::string source_name = param2Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[source_name, &out_jsonReturn]() {
-			OBSSourceAutoRelease source = obs_get_source_by_name(source_name.c_str());
-			if (!source)
-			{
-				out_jsonReturn = Json(Json::object({{"error", "Did not find a source with name " + source_name}})).dump();
-				return;
-			}
+	// The lookup takes the sources lock and hands back a reference, the size getters are safe from any thread
+	OBSSourceAutoRelease source = obs_get_source_by_name(source_name.c_str());
+	if (!source)
+	{
+		out_jsonReturn = Json(Json::object({{"error", "Did not find a source with name " + source_name}})).dump();
+		return;
+	}
 
-			uint32_t width = obs_source_get_width(source);
-			uint32_t height = obs_source_get_height(source);
+	uint32_t width = obs_source_get_width(source);
+	uint32_t height = obs_source_get_height(source);
 
-			out_jsonReturn = Json(Json::object({{"width", static_cast<int>(width)}, {"height", static_cast<int>(height)}})).dump();
-		},
-		Qt::BlockingQueuedConnection);
+	out_jsonReturn = Json(Json::object({{"width", static_cast<int>(width)}, {"height", static_cast<int>(height)}})).dump();
 }
 
 
 void PluginJsHandler::JS_GET_SCALE(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
+	TypedArgs args;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, args.scene_name, args.source_name))
+		return;
+
+	getSceneItemScale(args, out_jsonReturn);
+}
+
+void PluginJsHandler::getSceneItemScale(const TypedArgs &args, std::string &out_jsonReturn)
+{
+	const std::string &scene_name = args.scene_name;
+	const std::string &source_name = args.source_name;
 
 	if (scene_name == source_name)
 	{
@@ -2875,45 +3424,22 @@ void PluginJsHandler::JS_GET_SCALE(const json11::Json &params, std::string &out_
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
-	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[scene_name, source_name, &out_jsonReturn]() {
-			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
-			if (!scene)
-				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
-			else if (!obs_source_is_scene(scene))
-				out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();
-			else
-			{
-				obs_scene_t *scene_obj = obs_scene_from_source(scene);
-				obs_sceneitem_t *scene_item = obs_scene_find_source(scene_obj, source_name.c_str());
-
-				if (!scene_item)
-				{
-					out_jsonReturn = Json(Json::object({{"error", "Failed to find the source in that scene"}})).dump();
-					return;
-				}
-
-				// Assuming obs_sceneitem_get_scale exists and retrieves the scale values.
-				vec2 scale_values;
-				obs_sceneitem_get_scale(scene_item, &scale_values);
+	readSceneItem(scene_name, source_name, out_jsonReturn, [&out_jsonReturn](obs_sceneitem_t *scene_item) {
+		// Assuming obs_sceneitem_get_scale exists and retrieves the scale values.
+		vec2 scale_values;
+		obs_sceneitem_get_scale(scene_item, &scale_values);
 
-				out_jsonReturn = Json(Json::object({{"x", scale_values.x}, {"y", scale_values.y}})).dump();
-			}
-		},
-		Qt::BlockingQueuedConnection);
+		out_jsonReturn = Json(Json::object({{"x", scale_values.x}, {"y", scale_values.y}})).dump();
+	});
 }
 
 void PluginJsHandler::JS_GET_SCENEITEM_SCALE_FILTER(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
+	std::string scene_name;
+	std::string source_name;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, scene_name, source_name))
+		return;
 
 	if (scene_name == source_name)
 	{
@@ -2921,43 +3447,20 @@ void PluginJsHandler::JS_GET_SCENEITEM_SCALE_FILTER(const json11::Json &params,
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
-	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[scene_name, source_name, &out_jsonReturn]() {
-			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
-			if (!scene)
-				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
-			else if (!obs_source_is_scene(scene))
-				out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();
-			else
-			{
-				obs_scene_t *scene_obj = obs_scene_from_source(scene);
-				obs_sceneitem_t *scene_item = obs_scene_find_source(scene_obj, source_name.c_str());
-
-				if (!scene_item)
-				{
-					out_jsonReturn = Json(Json::object({{"error", "Failed to find the source in that scene"}})).dump();
-					return;
-				}
-
-				// Assuming obs_sceneitem_get_scale_filter exists and retrieves the scale filter value.
-				int scale_filter = static_cast<int>(obs_sceneitem_get_scale_filter(scene_item));
-				out_jsonReturn = Json(Json::object({{"scale_filter", scale_filter}})).dump();
-			}
-		},
-		Qt::BlockingQueuedConnection);
+	readSceneItem(scene_name, source_name, out_jsonReturn, [&out_jsonReturn](obs_sceneitem_t *scene_item) {
+		// Assuming obs_sceneitem_get_scale_filter exists and retrieves the scale filter value.
+		int scale_filter = static_cast<int>(obs_sceneitem_get_scale_filter(scene_item));
+		out_jsonReturn = Json(Json::object({{"scale_filter", scale_filter}})).dump();
+	});
 }
 
 void PluginJsHandler::JS_GET_SCENEITEM_BLENDING_MODE(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
+	std::string scene_name;
+	std::string source_name;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, scene_name, source_name))
+		return;
 
 	if (scene_name == source_name)
 	{
@@ -2965,43 +3468,20 @@ void PluginJsHandler::JS_GET_SCENEITEM_BLENDING_MODE(const json11::Json &params,
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
-	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[scene_name, source_name, &out_jsonReturn]() {
-			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
-			if (!scene)
-				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
-			else if (!obs_source_is_scene(scene))
-				out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();
-			else
-			{
-				obs_scene_t *scene_obj = obs_scene_from_source(scene);
-				obs_sceneitem_t *scene_item = obs_scene_find_source(scene_obj, source_name.c_str());
-
-				if (!scene_item)
-				{
-					out_jsonReturn = Json(Json::object({{"error", "Failed to find the source in that scene"}})).dump();
-					return;
-				}
-
-				// Assuming obs_sceneitem_get_blending_mode exists and retrieves the blending mode value.
-				int blending_mode = static_cast<int>(obs_sceneitem_get_blending_mode(scene_item));
-				out_jsonReturn = Json(Json::object({{"blending_mode", blending_mode}})).dump();
-			}
-		},
-		Qt::BlockingQueuedConnection);
+	readSceneItem(scene_name, source_name, out_jsonReturn, [&out_jsonReturn](obs_sceneitem_t *scene_item) {
+		// Assuming obs_sceneitem_get_blending_mode exists and retrieves the blending mode value.
+		int blending_mode = static_cast<int>(obs_sceneitem_get_blending_mode(scene_item));
+		out_jsonReturn = Json(Json::object({{"blending_mode", blending_mode}})).dump();
+	});
 }
 
 void PluginJsHandler::JS_GET_SCENEITEM_BLENDING_METHOD(const json11::Json &params, std::string &out_jsonReturn)
 {
-	const auto &param2Value = params["param2"];
-	const auto &param3Value = params["param3"];
+	std::string scene_name;
+	std::string source_name;
 
-	std::string scene_name = param2Value.string_value();
-	std::string source_name = param3Value.string_value();
+	if (!JsArgBinder::bindArgs(params, out_jsonReturn, scene_name, source_name))
+		return;
 
 	if (scene_name == source_name)
 	{
@@ -3009,34 +3489,11 @@ void PluginJsHandler::JS_GET_SCENEITEM_BLENDING_METHOD(const json11::Json &param
 		return;
 	}
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
-	// This code is executed in the context of the QMainWindow's thread.
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[scene_name, source_name, &out_jsonReturn]() {
-			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
-			if (!scene)
-				out_jsonReturn = Json(Json::object({{"error", "Did not find an object with name " + scene_name}})).dump();
-			else if (!obs_source_is_scene(scene))
-				out_jsonReturn = Json(Json::object({{"error", "The object found is not a scene"}})).dump();
-			else
-			{
-				obs_scene_t *scene_obj = obs_scene_from_source(scene);
-				obs_sceneitem_t *scene_item = obs_scene_find_source(scene_obj, source_name.c_str());
-
-				if (!scene_item)
-				{
-					out_jsonReturn = Json(Json::object({{"error", "Failed to find the source in that scene"}})).dump();
-					return;
-				}
-
-				// Assuming obs_sceneitem_get_blending_method exists and retrieves the blending method value.
-				int blending_method = static_cast<int>(obs_sceneitem_get_blending_method(scene_item));
-				out_jsonReturn = Json(Json::object({{"blending_method", blending_method}})).dump();
-			}
-		},
-		Qt::BlockingQueuedConnection);
+	readSceneItem(scene_name, source_name, out_jsonReturn, [&out_jsonReturn](obs_sceneitem_t *scene_item) {
+		// Assuming obs_sceneitem_get_blending_method exists and retrieves the blending method value.
+		int blending_method = static_cast<int>(obs_sceneitem_get_blending_method(scene_item));
+		out_jsonReturn = Json(Json::object({{"blending_method", blending_method}})).dump();
+	});
 }
 
 void PluginJsHandler::JS_SCENE_GET_SOURCES(const json11::Json &params, std::string &out_jsonReturn)
@@ -3044,11 +3501,16 @@ void PluginJsHandler::JS_SCENE_GET_SOURCES(const json11::Json &params, std::stri
 	const auto &param2Value = params["param2"];
 	std::string scene_name = param2Value.string_value();
 
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+	const std::string cacheKey = "scene_sources:" + scene_name;
 
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[scene_name, &out_jsonReturn]() {
+	if (SourceQueryCache::instance().get(cacheKey, out_jsonReturn))
+		return;
+
+	const uint64_t generation = SourceQueryCache::instance().generation();
+	bool found = false;
+
+	runOnMainThread(
+		[scene_name, &found, &out_jsonReturn]() {
 			OBSSourceAutoRelease scene = obs_get_source_by_name(scene_name.c_str());
 			if (!scene)
 			{
@@ -3081,8 +3543,12 @@ void PluginJsHandler::JS_SCENE_GET_SOURCES(const json11::Json &params, std::stri
 				&source_names);
 
 			out_jsonReturn = Json(Json::object({{"source_names", source_names}})).dump();
-		},
-		Qt::BlockingQueuedConnection);
+			found = true;
+		});
+
+	// Errors aren't cached, the scene may show up later without a signal we listen to
+	if (found)
+		SourceQueryCache::instance().put(cacheKey, generation, out_jsonReturn);
 }
 
 void PluginJsHandler::JS_RESTART_OBS(const json11::Json& params, std::string& out_jsonReturn)
@@ -3100,10 +3566,12 @@ void PluginJsHandler::JS_RESTART_OBS(const json11::Json& params, std::string& ou
 
 void PluginJsHandler::JS_ENUM_SCENES(const json11::Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+	if (SourceQueryCache::instance().get("enum_scenes", out_jsonReturn))
+		return;
 
-	QMetaObject::invokeMethod(
-		mainWindow,
+	const uint64_t generation = SourceQueryCache::instance().generation();
+
+	runOnMainThread(
 		[&out_jsonReturn]() {
 			std::vector<json11::Json> sourcesList;
 
@@ -3126,16 +3594,19 @@ void PluginJsHandler::JS_ENUM_SCENES(const json11::Json &params, std::string &ou
 				&sourcesList);
 
 			out_jsonReturn = json11::Json(sourcesList).dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
+
+	SourceQueryCache::instance().put("enum_scenes", generation, out_jsonReturn);
 }
 
 void PluginJsHandler::JS_QUERY_ALL_SOURCES(const json11::Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
+	if (SourceQueryCache::instance().get("all_sources", out_jsonReturn))
+		return;
 
-	QMetaObject::invokeMethod(
-		mainWindow,
+	const uint64_t generation = SourceQueryCache::instance().generation();
+
+	runOnMainThread(
 		[&out_jsonReturn]() {
 			std::vector<json11::Json> sourcesList;
 
@@ -3158,30 +3629,25 @@ void PluginJsHandler::JS_QUERY_ALL_SOURCES(const json11::Json &params, std::stri
 				&sourcesList);
 
 			out_jsonReturn = json11::Json(sourcesList).dump();
-		},
-		Qt::BlockingQueuedConnection);
+		});
+
+	SourceQueryCache::instance().put("all_sources", generation, out_jsonReturn);
 }
 
 void PluginJsHandler::JS_GET_CANVAS_DIMENSIONS(const json11::Json &params, std::string &out_jsonReturn)
 {
-	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
-
-	QMetaObject::invokeMethod(
-		mainWindow,
-		[&out_jsonReturn]() {
-			obs_video_info ovi;
-			if (obs_get_video_info(&ovi))
-			{
-				uint32_t canvas_width = ovi.base_width;
-				uint32_t canvas_height = ovi.base_height;
-				out_jsonReturn = Json(Json::object({{"width", static_cast<int>(canvas_width)}, {"height", static_cast<int>(canvas_height)}})).dump();
-			}
-			else
-			{
-				out_jsonReturn = Json(Json::object({{"error", "Failed to get canvas dimensions"}})).dump();
-			}
-		},
-		Qt::BlockingQueuedConnection);
+	// obs_get_video_info copies the current settings out, safe from any thread
+	obs_video_info ovi;
+	if (obs_get_video_info(&ovi))
+	{
+		uint32_t canvas_width = ovi.base_width;
+		uint32_t canvas_height = ovi.base_height;
+		out_jsonReturn = Json(Json::object({{"width", static_cast<int>(canvas_width)}, {"height", static_cast<int>(canvas_height)}})).dump();
+	}
+	else
+	{
+		out_jsonReturn = Json(Json::object({{"error", "Failed to get canvas dimensions"}})).dump();
+	}
 }
 
 /***
@@ -3191,7 +3657,18 @@ void PluginJsHandler::JS_GET_CANVAS_DIMENSIONS(const json11::Json &params, std::
 /*static*/
 void PluginJsHandler::handle_obs_frontend_event(obs_frontend_event event, void *data)
 {
-
+	switch (event)
+	{
+	// Covers what the libobs signals can't see, like collections being added, renamed or swapped wholesale
+	case OBS_FRONTEND_EVENT_SCENE_LIST_CHANGED:
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED:
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_LIST_CHANGED:
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP:
+		SourceQueryCache::instance().invalidate();
+		break;
+	default:
+		break;
+	}
 }
 
 /***
@@ -3251,8 +3728,7 @@ void PluginJsHandler::saveSlabsBrowserDocks()
 {
 	QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
 
-	QMetaObject::invokeMethod(
-		mainWindow,
+	runOnMainThread(
 		[mainWindow, this]() {
 			Json::array jarray;
 			QMainWindow *mainWindow = (QMainWindow *)obs_frontend_get_main_window();
@@ -3292,8 +3768,7 @@ void PluginJsHandler::saveSlabsBrowserDocks()
 			std::string output = Json(jarray).dump();
 			config_set_string(obs_frontend_get_global_config(), "BasicWindow", "SlabsBrowserDocks", output.c_str());
 
-		},
-		Qt::BlockingQueuedConnection);
+		});
 }
 
 // March 21st, 2024
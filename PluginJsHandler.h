@@ -1,23 +1,41 @@
 #pragma once
 
 #include <mutex>
+#include <memory>
 #include <thread>
 #include <vector>
+#include <set>
+#include <functional>
+#include <condition_variable>
 #include <obs.h>
 
 #include <QStringList>
 
 #include <json11/json11.hpp>
 
+#include "JavascriptApi.h"
+#include "PriorityLane.h"
+
 class QDockWidget;
 
 class PluginJsHandler
 {
 public:
+	// Arguments of a request that arrived as a typed grpc message instead of JSON params, see dispatchTypedRequest
+	struct TypedArgs
+	{
+		std::string scene_name;
+		std::string source_name;
+		vec2 pos = {};
+		vec2 scale = {};
+		float rotation = 0;
+		obs_sceneitem_crop crop = {};
+	};
+
 	void start();
 	void stop();
-	void pushApiRequest(const std::string &funcName, const std::string &params);
-	void executeApiRequest(const std::string &funcName, const std::string &params);
+	void pushApiRequest(std::string funcName, std::string params, const int callbackId, const int requestedPriority, const int browserId, std::unique_ptr<TypedArgs> typedArgs = nullptr);
+	void cancelApiRequests(const std::vector<int> &callbackIds);
 	void loadSlabsBrowserDocks();
 	void saveSlabsBrowserDocks();
 	void loadFonts();
@@ -33,11 +51,54 @@ public:
 	}
 
 private:
+	struct ApiRequest
+	{
+		std::string funcName;
+		std::string params;
+
+		// Reads wait until this many mutations have completed, so they never observe state older than what was sent before them
+		uint64_t mutationTicket = 0;
+
+		// A high priority mutation, it keeps its place among mutations but the read and IO lanes hold back until it's done
+		bool urgent = false;
+
+		// param1, used to drop the request if its page goes away before it runs
+		int callbackId = 0;
+
+		// The page that made the call, see grpc_js_api_Request::browser_id
+		int browserId = 0;
+
+		JavascriptApi::JSFuncs funcId = JavascriptApi::JS_INVALID;
+		uint64_t enqueuedNs = 0;
+
+		// Set instead of params for the typed fast path
+		std::unique_ptr<TypedArgs> typedArgs;
+	};
+
+	// One lane per JavascriptApi::JSFuncClass, each drained by its own threads
+	using RequestLane = PriorityLane<ApiRequest>;
+
 	PluginJsHandler();
 	~PluginJsHandler();
 
-	void workerThread();
+	void workerThread(RequestLane &lane, const JavascriptApi::JSFuncClass funcClass);
 	void freezeCheckThread();
+	bool popApiRequest(RequestLane &lane, ApiRequest &out);
+	void completeMutation(const uint64_t ticket);
+	RequestLane &getLane(const JavascriptApi::JSFuncClass funcClass);
+	void executeApiRequest(const ApiRequest &request);
+	void dispatchApiRequest(const JavascriptApi::JSFuncs funcId, const json11::Json &params, std::string &out_jsonReturn);
+	void dispatchTypedRequest(const JavascriptApi::JSFuncs funcId, const TypedArgs &args, std::string &out_jsonReturn);
+
+	// Shared by the JSON handlers and the typed path
+	void setSceneItemPos(const TypedArgs &args, std::string &out_jsonReturn);
+	void setSceneItemRot(const TypedArgs &args, std::string &out_jsonReturn);
+	void setSceneItemScale(const TypedArgs &args, std::string &out_jsonReturn);
+	void setSceneItemCrop(const TypedArgs &args, std::string &out_jsonReturn);
+	void getSceneItemPos(const TypedArgs &args, std::string &out_jsonReturn);
+	void getSceneItemRot(const TypedArgs &args, std::string &out_jsonReturn);
+	void getSceneItemScale(const TypedArgs &args, std::string &out_jsonReturn);
+	void getSceneItemCrop(const TypedArgs &args, std::string &out_jsonReturn);
 
 	void JS_QUERY_DOCKS(const json11::Json &params, std::string &out_jsonReturn);
 	void JS_DOCK_EXECUTEJAVASCRIPT(const json11::Json &params, std::string &out_jsonReturn);
@@ -86,6 +147,7 @@ private:
 	void JS_SET_SCENEITEM_BLENDING_MODE(const json11::Json &params, std::string &out_jsonReturn);
 	void JS_SET_SCENEITEM_BLENDING_METHOD(const json11::Json &params, std::string &out_jsonReturn);
 	void JS_SET_SCALE(const json11::Json &params, std::string &out_jsonReturn);
+	void JS_COMMIT_SCENEITEM_TRANSFORMS(const json11::Json &params, std::string &out_jsonReturn);
 	void JS_GET_SCENEITEM_POS(const json11::Json &params, std::string &out_jsonReturn);
 	void JS_GET_SCENEITEM_ROT(const json11::Json &params, std::string &out_jsonReturn);
 	void JS_GET_SCENEITEM_CROP(const json11::Json &params, std::string &out_jsonReturn);
@@ -115,18 +177,38 @@ private:
 	void JS_GET_LOGS_REPORT_STRING(const json11::Json &params, std::string &out_jsonReturn);
 	void JS_SOURCE_FILTER_ADD(const json11::Json &params, std::string &out_jsonReturn);
 	void JS_SOURCE_FILTER_REMOVE(const json11::Json &params, std::string &out_jsonReturn);
+	void JS_BATCH(const json11::Json &params, std::string &out_jsonReturn);
+	void JS_GET_PERF_STATS(const json11::Json &params, std::string &out_jsonReturn);
 
 	std::wstring getDownloadsDir() const;
 	std::wstring getFontsDir() const;
 
 	static QDockWidget *findDock(const std::string &objectName);
+	static void runOnMainThread(const std::function<void()> &task);
+	static void readSceneItem(const std::string &scene_name, const std::string &source_name, std::string &out_jsonReturn, const std::function<void(obs_sceneitem_t *)> &read);
+
+	// Largest piece of a file fs_readFile returns per call when given an offset, under 3mb once base64 so one call stays quick
+	static constexpr uint64_t kMaxReadFileChunk = 2 * 1024 * 1024;
+
+	static void readFileRange(const std::string &filepath, const uint64_t offset, const uint64_t length, std::string &out_jsonReturn);
 
-	std::mutex m_queueMtx;
 	std::atomic<bool> m_running = false;
-	std::vector<std::pair<std::string, std::string>> m_queudRequests;
-	std::thread m_workerThread;
 	std::thread m_freezeCheckThread;
 
+	RequestLane m_mutateLane;
+	RequestLane m_readLane;
+	RequestLane m_ioLane;
+
+	std::mutex m_mutationsMtx;
+	std::condition_variable m_mutationsCv;
+	std::atomic<uint64_t> m_mutationsQueued = 0;
+	uint64_t m_mutationsDone = 0;
+	std::set<uint64_t> m_mutationsFinished;
+
+	// Queued or running urgent mutations, while there are any the read and IO lanes only start high priority work
+	std::atomic<int> m_urgentMutations = 0;
+	void finishUrgentMutation();
+
 	bool m_restartApp = false;
 
 	std::unique_ptr<QString> m_restartProgramStr;
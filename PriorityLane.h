@@ -0,0 +1,71 @@
+#pragma once
+
+#include "JavascriptApi.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// One queue per JavascriptApi::JSFuncPriority, drained by the lane's own threads, see PluginJsHandler::pushApiRequest
+// No OBS or Qt in here so tools/ipc-bench times the same queue the plugin runs
+template<typename Request> struct PriorityLane
+{
+	std::mutex mtx;
+	std::condition_variable cv;
+
+	// Indexed by JavascriptApi::JSFuncPriority, the highest non-empty queue is served first
+	std::vector<Request> queues[JavascriptApi::JS_PRIORITY_COUNT];
+	size_t heads[JavascriptApi::JS_PRIORITY_COUNT] = {};
+
+	std::vector<std::thread> threads;
+
+	// Needs mtx held, -1 when nothing is ready. highOnly passes over everything below JS_PRIORITY_HIGH
+	int findReadyPriority(const bool highOnly) const
+	{
+		for (int priority = 0; priority < (highOnly ? JavascriptApi::JS_PRIORITY_HIGH + 1 : JavascriptApi::JS_PRIORITY_COUNT); ++priority)
+		{
+			if (heads[priority] < queues[priority].size())
+				return priority;
+		}
+
+		return -1;
+	}
+
+	void push(const int priority, Request request)
+	{
+		{
+			std::lock_guard<std::mutex> grd(mtx);
+			queues[priority].push_back(std::move(request));
+		}
+
+		cv.notify_one();
+	}
+
+	// Sleeps until something is ready, false once stopped() is true. highOnly() is asked again on every wake
+	template<typename Stopped, typename HighOnly> bool pop(Request &out, const Stopped &stopped, const HighOnly &highOnly)
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		cv.wait(lock, [this, &stopped, &highOnly] { return findReadyPriority(highOnly()) >= 0 || stopped(); });
+
+		if (stopped())
+			return false;
+
+		const int priority = findReadyPriority(highOnly());
+		auto &queue = queues[priority];
+		size_t &head = heads[priority];
+
+		out = std::move(queue[head++]);
+
+		// Drained, rewind instead of erasing from the front so the capacity is reused
+		if (head == queue.size())
+		{
+			queue.clear();
+			head = 0;
+		}
+
+		return true;
+	}
+};
@@ -140,10 +140,11 @@ void QtGuiModifications::outsideInvokeClickStreamButton()
 	QtGuiModifications::instance().m_obs_streamButton->click();
 }
 
-void QtGuiModifications::setJavascriptToCallOnStreamClick(const std::string &str)
+void QtGuiModifications::setJavascriptToCallOnStreamClick(const std::string &str, const int browserId)
 {
 	std::lock_guard<std::recursive_mutex> grd(m_mutex);
 	m_jsToCallOnStreamClick = str;
+	m_jsToCallOnStreamClickBrowserId = browserId;
 }
 
 /*static*/
@@ -170,10 +171,25 @@ void QtGuiModifications::handle_obs_frontend_event(obs_frontend_event event, voi
 
 void QtGuiModifications::onStartStreamingRequest()
 {
-	if (!m_jsToCallOnStreamClick.empty())
+	std::string jsToCall;
+	int browserId = 0;
+
+	{
+		std::lock_guard<std::recursive_mutex> grd(m_mutex);
+		jsToCall = m_jsToCallOnStreamClick;
+		browserId = m_jsToCallOnStreamClickBrowserId;
+	}
+
+	if (!jsToCall.empty())
 	{
+		// 0 if the request didn't say which page it came from, the browser then picks the one that called last
+		std::vector<int> browserIds;
+
+		if (browserId != 0)
+			browserIds.push_back(browserId);
+
 		// Run thread as to not block
-		std::thread([&]() { GrpcPlugin::instance().getClient()->send_executeJavascript(m_jsToCallOnStreamClick); }).detach();
+		std::thread([jsToCall, browserIds]() { GrpcPlugin::instance().getClient()->send_executeJavascript(jsToCall, browserIds); }).detach();
 		return;
 	}
 
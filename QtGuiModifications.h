@@ -21,7 +21,7 @@ public:
 public:
 	void stop();
 	void outsideInvokeClickStreamButton();
-	void setJavascriptToCallOnStreamClick(const std::string& str);
+	void setJavascriptToCallOnStreamClick(const std::string& str, const int browserId);
 
 	static void handle_obs_frontend_event(enum obs_frontend_event event, void *data);
 
@@ -39,6 +39,7 @@ private:
 
 	size_t m_streamingHotkeyId = 0;
 	std::string m_jsToCallOnStreamClick = "";
+	int m_jsToCallOnStreamClickBrowserId = 0;
 	std::recursive_mutex m_mutex;
 	std::thread m_workerThread;
 	std::string m_streamKeyCache;
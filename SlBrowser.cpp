@@ -1,6 +1,7 @@
 #include "SlBrowser.h"
 #include "SlBrowserWidget.h"
 #include "GrpcBrowser.h"
+#include "IpcEndpoint.h"
 #include "CrashHandler.h"
 
 #include <functional>
@@ -55,20 +56,24 @@ void SlBrowser::run(int argc, char *argv[])
 	}
 
 	m_obs64_PIDt = atoi(argv[1]);
-	int32_t parentListenPort = atoi(argv[2]);
-	int32_t myListenPort = atoi(argv[3]);
+	std::string parentAddress = IpcEndpoint::fromArg(argv[2]);
+	std::string myAddress = IpcEndpoint::fromArg(argv[3]);
 
-	if (!GrpcBrowser::instance().startServer(myListenPort))
+	if (!GrpcBrowser::instance().startServer(myAddress))
 	{
 		printf("sl-proxy: failed to start grpc server, GetLastError = %d\n", GetLastError());
 		return;
 	}
 
-	if (!GrpcBrowser::instance().connectToClient(parentListenPort))
+	if (!GrpcBrowser::instance().connectToClient(parentAddress))
 	{
 		printf("sl-proxy: failed to connected to plugin's grpc server, GetLastError = %d\n", GetLastError());
 		return;
 	}
+
+	// Optional, the plugin only uses it once it sees we've attached
+	if (!GrpcBrowser::instance().openPayloadRing(m_obs64_PIDt))
+		printf("sl-proxy: failed to open payload ring, large results will arrive inline\n");
 	
 	QApplication a(argc, argv);
 
@@ -0,0 +1,126 @@
+#include "SourceQueryCache.h"
+
+namespace {
+
+const char *const kGlobalSignals[] = {"source_create", "source_destroy", "source_remove", "source_rename"};
+const char *const kSceneSignals[] = {"item_add", "item_remove", "reorder", "refresh"};
+
+}
+
+void SourceQueryCache::connect()
+{
+	signal_handler_t *handler = obs_get_signal_handler();
+
+	for (const char *signal : kGlobalSignals)
+		signal_handler_connect(handler, signal, onSourceChanged, this);
+
+	// New scenes also need their item signals
+	signal_handler_connect(handler, "source_create", onSourceCreated, this);
+	signal_handler_connect(handler, "source_destroy", onSourceDestroyed, this);
+
+	// Scenes that already exist
+	obs_enum_scenes(
+		[](void *data, obs_source_t *source) -> bool {
+			static_cast<SourceQueryCache *>(data)->connectScene(source);
+			return true;
+		},
+		this);
+
+	invalidate();
+}
+
+void SourceQueryCache::disconnect()
+{
+	signal_handler_t *handler = obs_get_signal_handler();
+
+	// No new scenes from here on
+	signal_handler_disconnect(handler, "source_create", onSourceCreated, this);
+
+	{
+		// A scene being destroyed waits here in onSourceDestroyed, so every one left is still alive
+		std::lock_guard<std::mutex> grd(m_scenesMtx);
+
+		for (obs_source_t *scene : m_scenes)
+		{
+			signal_handler_t *sceneHandler = obs_source_get_signal_handler(scene);
+
+			for (const char *signal : kSceneSignals)
+				signal_handler_disconnect(sceneHandler, signal, onSourceChanged, this);
+		}
+
+		m_scenes.clear();
+	}
+
+	signal_handler_disconnect(handler, "source_destroy", onSourceDestroyed, this);
+
+	for (const char *signal : kGlobalSignals)
+		signal_handler_disconnect(handler, signal, onSourceChanged, this);
+
+	std::lock_guard<std::mutex> grd(m_mtx);
+	m_entries.clear();
+}
+
+bool SourceQueryCache::get(const std::string &key, std::string &out_json)
+{
+	const uint64_t current = generation();
+
+	std::lock_guard<std::mutex> grd(m_mtx);
+	auto itr = m_entries.find(key);
+
+	if (itr == m_entries.end() || itr->second.generation != current)
+		return false;
+
+	out_json = itr->second.json;
+	return true;
+}
+
+void SourceQueryCache::put(const std::string &key, const uint64_t builtGeneration, const std::string &json)
+{
+	// Something changed while this was being built, it may already be stale
+	if (builtGeneration != generation())
+		return;
+
+	std::lock_guard<std::mutex> grd(m_mtx);
+	m_entries[key] = {builtGeneration, json};
+}
+
+/*static*/
+void SourceQueryCache::onSourceChanged(void *data, calldata_t *)
+{
+	static_cast<SourceQueryCache *>(data)->invalidate();
+}
+
+/*static*/
+void SourceQueryCache::onSourceCreated(void *data, calldata_t *params)
+{
+	if (obs_source_t *source = static_cast<obs_source_t *>(calldata_ptr(params, "source")))
+		static_cast<SourceQueryCache *>(data)->connectScene(source);
+}
+
+/*static*/
+void SourceQueryCache::onSourceDestroyed(void *data, calldata_t *params)
+{
+	// Its signal handler goes with it, only forget it so disconnect doesn't touch it
+	SourceQueryCache *self = static_cast<SourceQueryCache *>(data);
+	obs_source_t *source = static_cast<obs_source_t *>(calldata_ptr(params, "source"));
+
+	std::lock_guard<std::mutex> grd(self->m_scenesMtx);
+	self->m_scenes.erase(source);
+}
+
+void SourceQueryCache::connectScene(obs_source_t *source)
+{
+	if (!obs_source_is_scene(source))
+		return;
+
+	std::lock_guard<std::mutex> grd(m_scenesMtx);
+
+	// Already connected, the enum in connect can race a source_create for the same scene
+	if (!m_scenes.insert(source).second)
+		return;
+
+	signal_handler_t *handler = obs_source_get_signal_handler(source);
+
+	for (const char *signal : kSceneSignals)
+		signal_handler_connect(handler, signal, onSourceChanged, this);
+}
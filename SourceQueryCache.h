@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <obs.h>
+
+// Serialized results of the scene/source enumeration queries, valid until libobs or the frontend reports a change
+// Entries carry the generation they were built under, any change bumps the generation so nothing has to be erased
+class SourceQueryCache
+{
+public:
+	void connect();
+	void disconnect();
+
+	// Call before building, the result is only stored if nothing changed while it was being built
+	uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+	void invalidate() { m_generation.fetch_add(1, std::memory_order_acq_rel); }
+
+	bool get(const std::string &key, std::string &out_json);
+	void put(const std::string &key, const uint64_t builtGeneration, const std::string &json);
+
+public:
+	static SourceQueryCache &instance()
+	{
+		static SourceQueryCache a;
+		return a;
+	}
+
+private:
+	struct Entry
+	{
+		uint64_t generation = 0;
+		std::string json;
+	};
+
+	SourceQueryCache() {}
+	~SourceQueryCache() {}
+
+	static void onSourceChanged(void *data, calldata_t *params);
+	static void onSourceCreated(void *data, calldata_t *params);
+	static void onSourceDestroyed(void *data, calldata_t *params);
+	void connectScene(obs_source_t *source);
+
+	std::atomic<uint64_t> m_generation = 1;
+	std::mutex m_mtx;
+	std::unordered_map<std::string, Entry> m_entries;
+
+	// Scenes with our item signals connected, not referenced, a scene leaves on source_destroy before it is freed
+	std::mutex m_scenesMtx;
+	std::unordered_set<obs_source_t *> m_scenes;
+};
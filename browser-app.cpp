@@ -3,11 +3,143 @@
 #include "JavascriptApi.h"
 
 #include <json11/json11.hpp>
+#include <base64/base64.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <include/base/cef_callback.h>
+#include <include/wrapper/cef_closure_task.h>
 
 #include <windows.h>
 
 using namespace json11;
 
+namespace {
+
+// Deep enough for any real argument, stops a cyclic object from recursing forever
+constexpr int kMaxArgumentDepth = 32;
+
+// Keeps decoded bytes alive for as long as the ArrayBuffer that uses them as its backing store, no second copy for V8
+class DecodedBytes : public CefV8ArrayBufferReleaseCallback
+{
+public:
+	explicit DecodedBytes(std::string bytes) : m_bytes(std::move(bytes)) {}
+
+	void *data() { return &m_bytes[0]; }
+	size_t size() const { return m_bytes.size(); }
+
+	// The bytes go with this object once CEF drops its reference
+	void ReleaseBuffer(void *) override {}
+
+private:
+	std::string m_bytes;
+
+	IMPLEMENT_REFCOUNTING(DecodedBytes);
+};
+
+#if ENABLE_V8_ARRAYBUFFER_DATA
+// Straight from the buffer's backing store into the message, length and offset clamped to what the buffer holds
+CefRefPtr<CefValue> arrayBufferToCefValue(CefRefPtr<CefV8Value> buffer, size_t offset, size_t length)
+{
+	CefRefPtr<CefValue> result = CefValue::Create();
+	const size_t byteLength = buffer->GetArrayBufferByteLength();
+	const char *data = static_cast<const char *>(buffer->GetArrayBufferData());
+
+	offset = std::min(offset, byteLength);
+	length = std::min(length, byteLength - offset);
+
+	if (data == nullptr || length == 0)
+		result->SetBinary(CefBinaryValue::Create("", 0));
+	else
+		result->SetBinary(CefBinaryValue::Create(data + offset, length));
+
+	return result;
+}
+#endif
+
+// Objects become dictionaries, arrays lists and ArrayBuffers (or views on one) binary, which the browser process turns into base64
+// Functions and anything else without a json equivalent become null, same as JSON.stringify would leave them out
+CefRefPtr<CefValue> v8ToCefValue(CefRefPtr<CefV8Value> value, const int depth)
+{
+	CefRefPtr<CefValue> result = CefValue::Create();
+
+	if (depth > kMaxArgumentDepth || value == nullptr || !value->IsValid())
+	{
+		result->SetNull();
+	}
+	else if (value->IsString())
+	{
+		result->SetString(value->GetStringValue());
+	}
+	else if (value->IsInt())
+	{
+		result->SetInt(value->GetIntValue());
+	}
+	else if (value->IsBool())
+	{
+		result->SetBool(value->GetBoolValue());
+	}
+	else if (value->IsDouble())
+	{
+		result->SetDouble(value->GetDoubleValue());
+	}
+#if ENABLE_V8_ARRAYBUFFER_DATA
+	else if (value->IsArrayBuffer())
+	{
+		result = arrayBufferToCefValue(value, 0, SIZE_MAX);
+	}
+#endif
+	else if (value->IsArray())
+	{
+		CefRefPtr<CefListValue> list = CefListValue::Create();
+
+		for (int i = 0; i < value->GetArrayLength(); ++i)
+			list->SetValue(size_t(i), v8ToCefValue(value->GetValue(i), depth + 1));
+
+		result->SetList(list);
+	}
+	else if (value->IsObject() && !value->IsFunction())
+	{
+#if ENABLE_V8_ARRAYBUFFER_DATA
+		// TypedArrays and DataView have no accessors of their own in CEF, only the part of the buffer they cover is sent
+		CefRefPtr<CefV8Value> buffer = value->GetValue("buffer");
+
+		if (buffer != nullptr && buffer->IsArrayBuffer())
+		{
+			CefRefPtr<CefV8Value> byteOffset = value->GetValue("byteOffset");
+			CefRefPtr<CefV8Value> byteLength = value->GetValue("byteLength");
+
+			if (byteOffset != nullptr && byteOffset->IsUInt() && byteLength != nullptr && byteLength->IsUInt())
+				return arrayBufferToCefValue(buffer, byteOffset->GetUIntValue(), byteLength->GetUIntValue());
+		}
+#endif
+
+		CefRefPtr<CefDictionaryValue> dictionary = CefDictionaryValue::Create();
+		std::vector<CefString> keys;
+		value->GetKeys(keys);
+
+		for (const auto &key : keys)
+		{
+			CefRefPtr<CefV8Value> member = value->GetValue(key);
+
+			if (member != nullptr && !member->IsFunction() && !member->IsUndefined())
+				dictionary->SetValue(key, v8ToCefValue(member, depth + 1));
+		}
+
+		result->SetDictionary(dictionary);
+	}
+	else
+	{
+		result->SetNull();
+	}
+
+	return result;
+}
+
+}
+
 CefRefPtr<CefRenderProcessHandler> BrowserApp::GetRenderProcessHandler()
 {
 	return this;
@@ -52,6 +184,102 @@ void BrowserApp::OnBeforeCommandLineProcessing(const CefString &, CefRefPtr<CefC
 	command_line->AppendSwitchWithValue("remote-allow-origins", "http://localhost:9123");
 }
 
+void BrowserApp::OnWebKitInitialized()
+{
+	CefPostDelayedTask(TID_RENDERER, base::BindOnce(&BrowserApp::SweepCallbacks, CefRefPtr<BrowserApp>(this)), int64_t(std::chrono::milliseconds(kSweepInterval).count()));
+}
+
+void BrowserApp::SweepCallbacks()
+{
+	for (auto &itr : m_callbacks.sweep())
+	{
+		CompleteCallback(itr.second, Json(Json::object({{"error", "Timed out waiting for a result"}})).dump(), true);
+	}
+
+	CefPostDelayedTask(TID_RENDERER, base::BindOnce(&BrowserApp::SweepCallbacks, CefRefPtr<BrowserApp>(this)), int64_t(std::chrono::milliseconds(kSweepInterval).count()));
+}
+
+void BrowserApp::CompleteCallback(const PendingCallback &callback, const CefString &jsonString, const bool failed)
+{
+	// Navigated away in the meantime, letting go of the refs is all that's left to do
+	if (!callback.context->IsValid())
+		return;
+
+	if (callback.binary && !failed && CompleteBinaryCallback(callback, jsonString))
+		return;
+
+	if (callback.function != nullptr)
+	{
+		CefV8ValueList args;
+		args.push_back(CefV8Value::CreateString(jsonString));
+		callback.function->ExecuteFunctionWithContext(callback.context, nullptr, args);
+		return;
+	}
+
+#if ENABLE_V8_PROMISES
+	if (callback.promise == nullptr || !callback.context->Enter())
+		return;
+
+	if (failed)
+	{
+		std::string err;
+		const std::string error = Json::parse(jsonString.ToString(), err)["error"].string_value();
+		callback.promise->RejectPromise(error.empty() ? jsonString : CefString(error));
+	}
+	else
+	{
+		callback.promise->ResolvePromise(CefV8Value::CreateString(jsonString));
+	}
+
+	callback.context->Exit();
+#endif
+}
+
+bool BrowserApp::CompleteBinaryCallback(const PendingCallback &callback, const CefString &jsonString)
+{
+	std::string err;
+	const Json result = Json::parse(jsonString.ToString(), err);
+	const Json &data = result["data"];
+
+	if (!data.is_string())
+		return false;
+
+	// { "offset": 0, "length": 0, "size": 0, "eof": true }
+	Json::object metadata = result.object_items();
+	metadata.erase("data");
+
+	CefRefPtr<DecodedBytes> bytes = new DecodedBytes(base64_decode(data.string_value()));
+
+	if (!callback.context->Enter())
+		return true;
+
+	CefRefPtr<CefV8Value> buffer = CefV8Value::CreateArrayBuffer(bytes->data(), bytes->size(), bytes);
+
+	if (callback.function != nullptr)
+	{
+		CefV8ValueList args;
+		args.push_back(CefV8Value::CreateString(Json(metadata).dump()));
+		args.push_back(buffer);
+		callback.function->ExecuteFunctionWithContext(callback.context, nullptr, args);
+	}
+#if ENABLE_V8_PROMISES
+	else if (callback.promise != nullptr)
+	{
+		// The promise gets a plain object with the bytes as "data"
+		CefRefPtr<CefV8Value> value = CefV8Value::CreateObject(nullptr, nullptr);
+
+		for (const auto &itr : metadata)
+			value->SetValue(itr.first, itr.second.is_bool() ? CefV8Value::CreateBool(itr.second.bool_value()) : CefV8Value::CreateDouble(itr.second.number_value()), V8_PROPERTY_ATTRIBUTE_NONE);
+
+		value->SetValue("data", buffer, V8_PROPERTY_ATTRIBUTE_NONE);
+		callback.promise->ResolvePromise(value);
+	}
+#endif
+
+	callback.context->Exit();
+	return true;
+}
+
 void BrowserApp::OnContextCreated(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame>, CefRefPtr<CefV8Context> context)
 {
 	CefRefPtr<CefV8Value> globalObj = context->GetGlobal();
@@ -61,10 +289,29 @@ void BrowserApp::OnContextCreated(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFr
 	slabsGlobal->SetValue("pluginVersion", CefV8Value::CreateString(OBS_BROWSER_VERSION_STRING), V8_PROPERTY_ATTRIBUTE_NONE);
 
 	for (auto &itr : JavascriptApi::getPluginFunctionNames())
-		slabsGlobal->SetValue(itr.first, CefV8Value::CreateFunction(itr.first, this), V8_PROPERTY_ATTRIBUTE_NONE);
+		slabsGlobal->SetValue(std::string(itr.name), CefV8Value::CreateFunction(std::string(itr.name), this), V8_PROPERTY_ATTRIBUTE_NONE);
 
 	for (auto &itr : JavascriptApi::getBrowserFunctionNames())
-		slabsGlobal->SetValue(itr.first, CefV8Value::CreateFunction(itr.first, this), V8_PROPERTY_ATTRIBUTE_NONE);	
+		slabsGlobal->SetValue(std::string(itr.name), CefV8Value::CreateFunction(std::string(itr.name), this), V8_PROPERTY_ATTRIBUTE_NONE);	
+
+#if ENABLE_V8_PROMISES
+	// Same functions without the callback argument, they return a promise of the json string the callback would have been given
+	// Rejected after JavascriptApi::getFunctionTimeout or if the request never reaches the plugin, errors from the plugin itself still resolve
+	CefRefPtr<CefV8Value> asyncObj = CefV8Value::CreateObject(nullptr, nullptr);
+	slabsGlobal->SetValue("async", asyncObj, V8_PROPERTY_ATTRIBUTE_NONE);
+
+	for (auto &itr : JavascriptApi::getPluginFunctionNames())
+		asyncObj->SetValue(std::string(itr.name), CefV8Value::CreateFunction(kAsyncPrefix + std::string(itr.name), this), V8_PROPERTY_ATTRIBUTE_NONE);
+
+	for (auto &itr : JavascriptApi::getBrowserFunctionNames())
+		asyncObj->SetValue(std::string(itr.name), CefV8Value::CreateFunction(kAsyncPrefix + std::string(itr.name), this), V8_PROPERTY_ATTRIBUTE_NONE);
+#endif
+}
+
+void BrowserApp::OnContextReleased(CefRefPtr<CefBrowser>, CefRefPtr<CefFrame>, CefRefPtr<CefV8Context> context)
+{
+	// The page is gone, whatever it was waiting on can't be delivered. A late result then simply finds no slot
+	m_callbacks.removeIf([&context](const PendingCallback &callback) { return callback.context->IsSame(context); });
 }
 
 bool BrowserApp::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefProcessId source_process, CefRefPtr<CefProcessMessage> message)
@@ -75,18 +322,14 @@ bool BrowserApp::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefP
 		int callbackID = arguments->GetInt(0);
 		CefString jsonString = arguments->GetString(1);
 
-		std::lock_guard<std::recursive_mutex> grd(m_callbackMutex);
-
-		if (CefRefPtr<CefV8Value> function = m_callbackMap[callbackID].first)
-		{
-			CefRefPtr<CefV8Context> context = m_callbackMap[callbackID].second;
+		// Set by the browser process when the call never got an answer from the plugin
+		const bool failed = arguments->GetSize() > 2 && arguments->GetBool(2);
 
-			CefV8ValueList args;
-			args.push_back(CefV8Value::CreateString(jsonString));
-			function->ExecuteFunctionWithContext(context, nullptr, args);
+		// Popped before it runs, the function is free to call straight back into Execute
+		PendingCallback callback;
 
-			m_callbackMap.erase(callbackID);
-		}
+		if (m_callbacks.pop(callbackID, callback))
+			CompleteCallback(callback, jsonString, failed);
 	}
 
 	if (message->GetName() == "executeJavascript")
@@ -95,23 +338,83 @@ bool BrowserApp::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefP
 		browser->GetMainFrame()->ExecuteJavaScript(arguments->GetString(0), browser->GetMainFrame()->GetURL(), 0); 
 	}
 
+	if (message->GetName() == "dispatchEvent")
+	{
+		CefRefPtr<CefListValue> arguments = message->GetArgumentList();
+		const std::string name = arguments->GetString(0).ToString();
+
+		// The browser process only forwards known names and valid json, and json is a valid js expression
+		if (JavascriptApi::isObsEventName(name))
+		{
+			const std::string script = "window.dispatchEvent(new CustomEvent(\"slabs:" + name + "\", { detail: " + arguments->GetString(1).ToString() + " }));";
+			browser->GetMainFrame()->ExecuteJavaScript(script, browser->GetMainFrame()->GetURL(), 0);
+		}
+	}
+
 	return true;
 }
 
-bool BrowserApp::Execute(const CefString &name, CefRefPtr<CefV8Value>, const CefV8ValueList &arguments, CefRefPtr<CefV8Value> &, CefString &)
+bool BrowserApp::Execute(const CefString &name, CefRefPtr<CefV8Value>, const CefV8ValueList &arguments, CefRefPtr<CefV8Value> &retval, CefString &)
 {
-	if (JavascriptApi::isValidFunctionName(name.ToString()))
+	std::string funcName = name.ToString();
+	const bool async = funcName.rfind(kAsyncPrefix, 0) == 0;
+
+	if (async)
+		funcName.erase(0, strlen(kAsyncPrefix));
+
+	if (JavascriptApi::isValidFunctionName(funcName))
 	{
 		int callBackId = 0;
+		const bool hasFunction = !async && arguments.size() >= 1 && arguments[0]->IsFunction();
+
+		const JavascriptApi::JSFuncs funcId = JavascriptApi::getFunctionId(funcName);
+		size_t firstArg = hasFunction ? 1 : 0;
+
+		// sl_callWithPriority(cb, priority, funcname, ...) is treated as the call it carries
+		JavascriptApi::JSFuncs targetId = funcId;
+
+		if (funcId == JavascriptApi::JS_CALL_WITH_PRIORITY && arguments.size() > firstArg + 1 && arguments[firstArg + 1]->IsString())
+		{
+			targetId = JavascriptApi::getFunctionId(arguments[firstArg + 1]->GetStringValue().ToString());
+			firstArg += 2;
+		}
+
+		const std::chrono::seconds timeout = JavascriptApi::getFunctionTimeout(targetId);
 
-		if (arguments.size() >= 1 && arguments[0]->IsFunction())
+		// fs_readFile(path, offset, ...) reads bytes, see CompleteBinaryCallback
+		const size_t offsetArg = firstArg + 1;
+		const bool binary = targetId == JavascriptApi::JS_READ_FILE && arguments.size() > offsetArg &&
+				    (arguments[offsetArg]->IsInt() || arguments[offsetArg]->IsUInt() || arguments[offsetArg]->IsDouble());
+
+#if ENABLE_V8_PROMISES
+		if (async)
+		{
+			retval = CefV8Value::CreatePromise();
+			callBackId = m_callbacks.insert({nullptr, retval, CefV8Context::GetCurrentContext(), binary}, timeout);
+
+			if (callBackId == 0)
+			{
+				retval->RejectPromise("Too many callbacks pending");
+				return true;
+			}
+		}
+#endif
+
+		if (hasFunction)
 		{
-			std::lock_guard<std::recursive_mutex> grd(m_callbackMutex);
-			callBackId = ++m_callbackIdCounter;
-			m_callbackMap[callBackId] = {arguments[0], CefV8Context::GetCurrentContext()};
+			callBackId = m_callbacks.insert({arguments[0], nullptr, CefV8Context::GetCurrentContext(), binary}, timeout);
+
+			// Every slot is taken by calls that were never answered, say so now rather than never
+			if (callBackId == 0)
+			{
+				CefV8ValueList args;
+				args.push_back(CefV8Value::CreateString(Json(Json::object({{"error", "Too many callbacks pending"}})).dump()));
+				arguments[0]->ExecuteFunction(nullptr, args);
+				return true;
+			}
 		}
 
-		CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create(name);
+		CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create(funcName);
 		CefRefPtr<CefListValue> args = msg->GetArgumentList();
 		args->SetInt(0, callBackId);
 
@@ -119,21 +422,23 @@ bool BrowserApp::Execute(const CefString &name, CefRefPtr<CefV8Value>, const Cef
 		for (u_long l = 0; l < arguments.size(); l++)
 		{
 			u_long pos;
-			if (arguments[0]->IsFunction())
+			if (hasFunction)
 				pos = l;
 			else
 				pos = l + 1;
 
-			if (arguments[l]->IsString())
-				args->SetString(pos, arguments[l]->GetStringValue());
-			else if (arguments[l]->IsInt())
-				args->SetInt(pos, arguments[l]->GetIntValue());
-			else if (arguments[l]->IsBool())
-				args->SetBool(pos, arguments[l]->GetBoolValue());
-			else if (arguments[l]->IsDouble())
-				args->SetDouble(pos, arguments[l]->GetDoubleValue());
+			// The callback itself, already registered above
+			if (hasFunction && l == 0)
+				continue;
+
+			// Nested data crosses as CEF values, the page no longer has to JSON.stringify it
+			args->SetValue(pos, v8ToCefValue(arguments[l], 0));
 		}
 
+		// The browser process only sees its own table, this one's is added for it
+		if (funcId == JavascriptApi::JS_BROWSER_GET_IPC_HEALTH)
+			args->SetString(args->GetSize(), m_callbacks.stats().dump());
+
 		CefRefPtr<CefBrowser> browser = CefV8Context::GetCurrentContext()->GetBrowser();
 		SendBrowserProcessMessage(browser, PID_BROWSER, msg);
 	}
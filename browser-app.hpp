@@ -1,22 +1,48 @@
 #pragma once
 
+#include <chrono>
 #include <map>
 #include <unordered_map>
 #include <functional>
 #include <mutex>
 
 #include "cef-headers.hpp"
+#include "GenerationalSlotTable.h"
 
 typedef std::function<void(CefRefPtr<CefBrowser>)> BrowserFunc;
 
 class BrowserApp : public CefApp, public CefRenderProcessHandler, public CefBrowserProcessHandler, public CefV8Handler
 {
+	struct PendingCallback
+	{
+		// One or the other, slabsGlobal.async.* calls get a promise
+		CefRefPtr<CefV8Value> function;
+		CefRefPtr<CefV8Value> promise;
 
-	int m_callbackIdCounter = 0;
-	std::map<int, std::pair<CefRefPtr<CefV8Value>, CefRefPtr<CefV8Context>>> m_callbackMap;
-	std::recursive_mutex m_callbackMutex;
+		CefRefPtr<CefV8Context> context;
+
+		// fs_readFile with an offset, the result's base64 "data" is handed over as an ArrayBuffer
+		bool binary = false;
+	};
+
+	// Holds the page's function and its context until the result arrives, the context is released the moment it's popped or swept
+	GenerationalSlotTable<PendingCallback> m_callbacks;
+
+	// Rejects whatever has waited longer than JavascriptApi::getFunctionTimeout, then schedules itself again
+	void SweepCallbacks();
+
+	// Calls the function with jsonString, or settles the promise. failed means the call never got an answer, the promise is rejected with its "error"
+	void CompleteCallback(const PendingCallback &callback, const CefString &jsonString, const bool failed);
+
+	// False if the result has no "data" to convert, e.g. an error, it's then completed like any other
+	bool CompleteBinaryCallback(const PendingCallback &callback, const CefString &jsonString);
 
 public:
+	static constexpr std::chrono::seconds kSweepInterval{1};
+
+	// Names the slabsGlobal.async.* functions are created with, to tell them apart in Execute
+	static constexpr const char *kAsyncPrefix = "async.";
+
 	inline BrowserApp() {}
 
 	virtual CefRefPtr<CefRenderProcessHandler> GetRenderProcessHandler() override;
@@ -24,7 +50,9 @@ public:
 	virtual void OnBeforeChildProcessLaunch(CefRefPtr<CefCommandLine> command_line) override;
 	virtual void OnRegisterCustomSchemes(CefRawPtr<CefSchemeRegistrar> registrar) override;
 	virtual void OnBeforeCommandLineProcessing(const CefString &process_type, CefRefPtr<CefCommandLine> command_line) override;
+	virtual void OnWebKitInitialized() override;
 	virtual void OnContextCreated(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefRefPtr<CefV8Context> context) override;
+	virtual void OnContextReleased(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefRefPtr<CefV8Context> context) override;
 	virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefProcessId source_process, CefRefPtr<CefProcessMessage> message) override;
 	virtual bool Execute(const CefString &name, CefRefPtr<CefV8Value> object, const CefV8ValueList &arguments, CefRefPtr<CefV8Value> &retval, CefString &exception) override;
 
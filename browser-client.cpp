@@ -113,6 +113,17 @@ json11::Json convertCefValueToJSON(CefRefPtr<CefValue> value)
 		return jsonList;
 	}
 
+	// ArrayBuffers and typed arrays from the page, json has no bytes
+	case VTYPE_BINARY: {
+		CefRefPtr<CefBinaryValue> binary = value->GetBinary();
+		std::string bytes(binary->GetSize(), '\0');
+
+		if (!bytes.empty())
+			binary->GetData(bytes.data(), bytes.size(), 0);
+
+		return base64_encode(bytes);
+	}
+
 	case VTYPE_DICTIONARY: {
 		const auto &dict = value->GetDictionary();
 		std::map<std::string, json11::Json> jsonMap;
@@ -146,33 +157,223 @@ std::string BrowserClient::cefListValueToJSONString(CefRefPtr<CefListValue> list
 	return json_str;
 }
 
+/*static*/
+bool BrowserClient::cefListValueToTypedArgs(const JavascriptApi::JSFuncs funcId, CefRefPtr<CefListValue> listValue, grpc_js_api_Request &request)
+{
+	size_t numberCount = 0;
+
+	switch (funcId)
+	{
+	case JavascriptApi::JS_GET_CURRENT_SCENE:
+	case JavascriptApi::JS_GET_IS_OBS_STREAMING:
+		request.mutable_no_args();
+		return true;
+	case JavascriptApi::JS_GET_SCENEITEM_POS:
+	case JavascriptApi::JS_GET_SCENEITEM_ROT:
+	case JavascriptApi::JS_GET_SCALE:
+	case JavascriptApi::JS_GET_SCENEITEM_CROP:
+		break;
+	case JavascriptApi::JS_SET_SCENEITEM_ROT:
+		numberCount = 1;
+		break;
+	case JavascriptApi::JS_SET_SCENEITEM_POS:
+	case JavascriptApi::JS_SET_SCALE:
+		numberCount = 2;
+		break;
+	case JavascriptApi::JS_SET_SCENEITEM_CROP:
+		numberCount = 4;
+		break;
+	default:
+		return false;
+	}
+
+	// [0] is the callback id, then scene, item and the numbers. Anything off goes as JSON so the plugin reports it the usual way
+	if (listValue->GetSize() < 3 + numberCount || listValue->GetType(1) != VTYPE_STRING || listValue->GetType(2) != VTYPE_STRING)
+		return false;
+
+	double numbers[4] = {};
+
+	for (size_t i = 0; i < numberCount; ++i)
+	{
+		if (listValue->GetType(3 + i) == VTYPE_INT)
+			numbers[i] = listValue->GetInt(3 + i);
+		else if (listValue->GetType(3 + i) == VTYPE_DOUBLE)
+			numbers[i] = listValue->GetDouble(3 + i);
+		else
+			return false;
+	}
+
+	grpc_typed_SceneItemTransform *transform = request.mutable_sceneitem_transform();
+	transform->set_scene(listValue->GetString(1).ToString());
+	transform->set_item(listValue->GetString(2).ToString());
+
+	switch (funcId)
+	{
+	case JavascriptApi::JS_SET_SCENEITEM_ROT:
+		transform->set_rot(float(numbers[0]));
+		break;
+	case JavascriptApi::JS_SET_SCENEITEM_POS:
+		transform->mutable_pos()->set_x(float(numbers[0]));
+		transform->mutable_pos()->set_y(float(numbers[1]));
+		break;
+	case JavascriptApi::JS_SET_SCALE:
+		transform->mutable_scale()->set_x(float(numbers[0]));
+		transform->mutable_scale()->set_y(float(numbers[1]));
+		break;
+	case JavascriptApi::JS_SET_SCENEITEM_CROP:
+		transform->mutable_crop()->set_left(int(numbers[0]));
+		transform->mutable_crop()->set_top(int(numbers[1]));
+		transform->mutable_crop()->set_right(int(numbers[2]));
+		transform->mutable_crop()->set_bottom(int(numbers[3]));
+		break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
 CefRefPtr<CefBrowser> BrowserClient::GetMostRecentRenderKnown()
 {
 	std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
 	return m_MostRecentRenderKnowOf;
 }
 
-void BrowserClient::RegisterCallback(const int functionId, CefRefPtr<CefBrowser> browser)
+CefRefPtr<CefBrowser> BrowserClient::GetBrowser(const int identifier)
 {
 	std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
-	m_callbackDictionary[functionId] = browser;
-	m_MostRecentRenderKnowOf = browser;
+	auto itr = m_browsers.find(identifier);
+	return itr != m_browsers.end() ? itr->second : nullptr;
+}
+
+int BrowserClient::RegisterCallback(const int rendererCallbackId, CefRefPtr<CefBrowser> browser, const JavascriptApi::JSFuncs funcId)
+{
+	ExpireCallbacks();
+
+	{
+		std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
+		m_MostRecentRenderKnowOf = browser;
+	}
+
+	return m_callbacks.insert({browser, rendererCallbackId}, JavascriptApi::getFunctionTimeout(funcId) + kCallbackGrace);
+}
+
+void BrowserClient::CancelCallbacks(CefRefPtr<CefBrowser> browser)
+{
+	std::vector<int> callbackIds;
+
+	for (auto &itr : m_callbacks.removeIf([&browser](const PendingCallback &callback) { return callback.browser->IsSame(browser); }))
+		callbackIds.push_back(itr.first);
+
+	// Nobody is left to receive these, let the plugin drop whatever hasn't started yet
+	if (!callbackIds.empty())
+		GrpcBrowser::instance().getClient()->send_cancelRequests(callbackIds);
 }
 
-CefRefPtr<CefBrowser> BrowserClient::PopCallback(const int functionId)
+void BrowserClient::ExpireCallbacks()
+{
+	std::vector<int> callbackIds;
+
+	// The renderer already gave up on these and told the page
+	for (auto &itr : m_callbacks.sweep())
+		callbackIds.push_back(itr.first);
+
+	if (!callbackIds.empty())
+		GrpcBrowser::instance().getClient()->send_cancelRequests(callbackIds);
+}
+
+std::vector<std::string> BrowserClient::SubscribeEvents(CefRefPtr<CefBrowser> browser, const std::vector<std::string> &names)
 {
 	std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
 
-	auto itr = m_callbackDictionary.find(functionId);
+	EventSubscription &subscription = m_eventSubscriptions[browser->GetIdentifier()];
+	subscription.browser = browser;
 
-	if (itr != m_callbackDictionary.end())
+	if (names.empty())
 	{
-		CefRefPtr<CefBrowser> browser = itr->second;
-		m_callbackDictionary.erase(itr);
-		return browser;
+		for (auto &itr : JavascriptApi::s_obsEvents)
+			subscription.names.insert(std::string(itr));
+	}
+	else
+	{
+		subscription.names.insert(names.begin(), names.end());
 	}
 
-	return nullptr;
+	return {subscription.names.begin(), subscription.names.end()};
+}
+
+std::vector<std::string> BrowserClient::UnsubscribeEvents(CefRefPtr<CefBrowser> browser, const std::vector<std::string> &names)
+{
+	std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
+
+	auto itr = m_eventSubscriptions.find(browser->GetIdentifier());
+
+	if (itr == m_eventSubscriptions.end())
+		return {};
+
+	if (names.empty())
+	{
+		m_eventSubscriptions.erase(itr);
+		return {};
+	}
+
+	for (const std::string &name : names)
+		itr->second.names.erase(name);
+
+	std::vector<std::string> result(itr->second.names.begin(), itr->second.names.end());
+
+	if (result.empty())
+		m_eventSubscriptions.erase(itr);
+
+	return result;
+}
+
+void BrowserClient::ClearEventSubscriptions(CefRefPtr<CefBrowser> browser)
+{
+	std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
+	m_eventSubscriptions.erase(browser->GetIdentifier());
+}
+
+void BrowserClient::DispatchObsEvent(const std::string &name, const std::string &jsonStr)
+{
+	// It's spliced into script on the renderer side, only known names and well formed json get that far
+	std::string err;
+
+	if (!JavascriptApi::isObsEventName(name) || Json::parse(jsonStr, err).is_null())
+		return;
+
+	std::vector<CefRefPtr<CefBrowser>> targets;
+
+	{
+		std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
+
+		for (auto &itr : m_eventSubscriptions)
+		{
+			if (itr.second.names.count(name) != 0)
+				targets.push_back(itr.second.browser);
+		}
+	}
+
+	for (auto &browser : targets)
+	{
+		CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("dispatchEvent");
+		CefRefPtr<CefListValue> execute_args = msg->GetArgumentList();
+		execute_args->SetString(0, name);
+		execute_args->SetString(1, jsonStr);
+
+		SendBrowserProcessMessage(browser, PID_RENDERER, msg);
+	}
+}
+
+CefRefPtr<CefBrowser> BrowserClient::PopCallback(const int callbackId, int &out_rendererCallbackId)
+{
+	PendingCallback callback;
+
+	if (!m_callbacks.pop(callbackId, callback))
+		return nullptr;
+
+	out_rendererCallbackId = callback.rendererCallbackId;
+	return callback.browser;
 }
 
 bool BrowserClient::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame>, CefProcessId processId, CefRefPtr<CefProcessMessage> message)
@@ -272,6 +473,67 @@ bool BrowserClient::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefR
 
 			break;
 		}
+		case JavascriptApi::JS_BROWSER_GET_IPC_HEALTH:
+		{
+			Json::object health = GrpcBrowser::instance().getClient()->health().object_items();
+			health["callbacks"] = GetCallbackStats();
+
+			// The renderer appends its own table's stats, it's the only one that knows them
+			std::string err;
+
+			if (!argsWithoutFunc.empty() && argsWithoutFunc.back()->GetType() == VTYPE_STRING)
+			{
+				Json rendererCallbacks = Json::parse(argsWithoutFunc.back()->GetString().ToString(), err);
+
+				if (rendererCallbacks.is_object())
+					health["renderer_callbacks"] = rendererCallbacks;
+			}
+
+			jsonOutput = Json(health).dump();
+			break;
+		}
+		case JavascriptApi::JS_BROWSER_SUBSCRIBE_EVENTS:
+		case JavascriptApi::JS_BROWSER_UNSUBSCRIBE_EVENTS:
+		{
+			if (argsWithoutFunc.size() < 1)
+			{
+				jsonOutput = Json(Json::object({{"error", "Invalid parameters"}})).dump();
+				break;
+			}
+
+			// An array straight from the page, or the same as a json string
+			std::string err;
+			Json events = argsWithoutFunc[0]->GetType() == VTYPE_LIST ? convertCefValueToJSON(argsWithoutFunc[0]) : Json::parse(argsWithoutFunc[0]->GetString().ToString(), err);
+
+			if (!events.is_array())
+			{
+				jsonOutput = Json(Json::object({{"error", "Invalid parameters"}})).dump();
+				break;
+			}
+
+			std::vector<std::string> names;
+
+			for (const auto &itr : events.array_items())
+			{
+				if (!JavascriptApi::isObsEventName(itr.string_value()))
+				{
+					jsonOutput = Json(Json::object({{"error", "Unknown event " + itr.dump()}})).dump();
+					break;
+				}
+
+				names.push_back(itr.string_value());
+			}
+
+			if (names.size() != events.array_items().size())
+				break;
+
+			if (JavascriptApi::getFunctionId(name) == JavascriptApi::JS_BROWSER_SUBSCRIBE_EVENTS)
+				jsonOutput = Json(Json::object({{"subscribed", SubscribeEvents(browser, names)}})).dump();
+			else
+				jsonOutput = Json(Json::object({{"subscribed", UnsubscribeEvents(browser, names)}})).dump();
+
+			break;
+		}
 		}
 
 		CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("executeCallback");
@@ -283,13 +545,75 @@ bool BrowserClient::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefR
 	}
 	else
 	{
-		RegisterCallback(funcid, browser);
+		std::string funcName = name;
+		int priority = 0;
 
-		if (!GrpcBrowser::instance().getClient()->send_js_api(name, cefListValueToJSONString(input_args)))
+		// sl_callWithPriority(cb, priority, funcname, ...) is unwrapped here, the plugin only sees the call it carries
+		if (JavascriptApi::getFunctionId(name) == JavascriptApi::JS_CALL_WITH_PRIORITY)
 		{
-			// todo; handle
-			abort();
-			return false;
+			JavascriptApi::JSFuncPriority requestedPriority;
+			funcName = input_args->GetSize() >= 3 ? input_args->GetString(2).ToString() : "";
+
+			if (!JavascriptApi::isPluginFunctionName(funcName) || JavascriptApi::getFunctionId(funcName) == JavascriptApi::JS_CALL_WITH_PRIORITY ||
+			    !JavascriptApi::getPriorityFromName(input_args->GetString(1).ToString(), requestedPriority))
+			{
+				CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("executeCallback");
+				CefRefPtr<CefListValue> execute_args = msg->GetArgumentList();
+				execute_args->SetInt(0, funcid);
+				execute_args->SetString(1, Json(Json::object({{"error", "Invalid parameters"}})).dump());
+
+				SendBrowserProcessMessage(browser, PID_RENDERER, msg);
+				return true;
+			}
+
+			// 0 on the wire means the function's default
+			priority = requestedPriority + 1;
+
+			// Received messages are read-only
+			input_args = input_args->Copy();
+			input_args->Remove(2);
+			input_args->Remove(1);
+		}
+
+		const JavascriptApi::JSFuncs funcId = JavascriptApi::getFunctionId(funcName);
+		const int callbackId = RegisterCallback(funcid, browser, funcId);
+
+		if (callbackId == 0)
+		{
+			CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("executeCallback");
+			CefRefPtr<CefListValue> execute_args = msg->GetArgumentList();
+			execute_args->SetInt(0, funcid);
+			execute_args->SetString(1, Json(Json::object({{"error", "Too many callbacks pending"}})).dump());
+
+			// Never reached the plugin, a promise is rejected rather than resolved with the error
+			execute_args->SetBool(2, true);
+
+			SendBrowserProcessMessage(browser, PID_RENDERER, msg);
+			return true;
+		}
+
+		grpc_js_api_Request request;
+		request.set_funcname(std::move(funcName));
+		request.set_callbackid(callbackId);
+		request.set_priority(priority);
+		request.set_browser_id(browser->GetIdentifier());
+
+		if (!cefListValueToTypedArgs(funcId, input_args, request))
+			request.set_params(cefListValueToJSONString(input_args));
+
+		// Only refused when the plugin has stopped answering for a long while, the page gets an error instead of a callback that never comes
+		if (!GrpcBrowser::instance().getClient()->send_js_api(std::move(request)))
+		{
+			int rendererCallbackId = 0;
+			PopCallback(callbackId, rendererCallbackId);
+
+			CefRefPtr<CefProcessMessage> msg = CefProcessMessage::Create("executeCallback");
+			CefRefPtr<CefListValue> execute_args = msg->GetArgumentList();
+			execute_args->SetInt(0, funcid);
+			execute_args->SetString(1, Json(Json::object({{"error", "Too many requests waiting on the plugin"}})).dump());
+			execute_args->SetBool(2, true);
+
+			SendBrowserProcessMessage(browser, PID_RENDERER, msg);
 		}
 	}
 
@@ -297,6 +621,24 @@ bool BrowserClient::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefR
 	return true;
 }
 
+void BrowserClient::OnAfterCreated(CefRefPtr<CefBrowser> browser)
+{
+	std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
+	m_browsers[browser->GetIdentifier()] = browser;
+}
+
+void BrowserClient::OnBeforeClose(CefRefPtr<CefBrowser> browser)
+{
+	CancelCallbacks(browser);
+	ClearEventSubscriptions(browser);
+
+	std::lock_guard<std::recursive_mutex> grd(m_recursiveMutex);
+	m_browsers.erase(browser->GetIdentifier());
+
+	if (m_MostRecentRenderKnowOf != nullptr && m_MostRecentRenderKnowOf->IsSame(browser))
+		m_MostRecentRenderKnowOf = nullptr;
+}
+
 void BrowserClient::GetViewRect(CefRefPtr<CefBrowser>, CefRect &rect)
 {
 	if (!valid())
@@ -384,6 +726,13 @@ bool BrowserClient::GetAudioParameters(CefRefPtr<CefBrowser> browser, CefAudioPa
 void BrowserClient::OnLoadStart(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, TransitionType transition_type)
 {
 	SlBrowser::instance().setMainLoadingInProgress(true);
+
+	// The page that made these requests is gone
+	if (frame->IsMain())
+	{
+		CancelCallbacks(browser);
+		ClearEventSubscriptions(browser);
+	}
 }
 
 void BrowserClient::OnLoadEnd(CefRefPtr<CefBrowser>, CefRefPtr<CefFrame> frame, int httpStatusCode)
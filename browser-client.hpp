@@ -1,16 +1,27 @@
 #pragma once
 
 #include "cef-headers.hpp"
+#include "GenerationalSlotTable.h"
+#include "JavascriptApi.h"
 
+#include <chrono>
 #include <map>
 #include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 struct BrowserSource;
+class grpc_js_api_Request;
 
 class BrowserClient : public CefClient, public CefDisplayHandler, public CefLifeSpanHandler, public CefRequestHandler, public CefResourceRequestHandler, public CefContextMenuHandler, public CefRenderHandler, public CefAudioHandler, public CefLoadHandler
 {
 
 public:
+	// Added to JavascriptApi::getFunctionTimeout, the page has been told by then and the plugin is asked to drop the request
+	static constexpr std::chrono::seconds kCallbackGrace{5};
+
 	inline BrowserClient(bool reroute_audio_) : m_reroute_audio(reroute_audio_) {}
 
 	/* CefClient */
@@ -30,6 +41,9 @@ public:
 	bool OnBeforePopup(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, const CefString &target_url, const CefString &target_frame_name, cef_window_open_disposition_t target_disposition, bool user_gesture, const CefPopupFeatures &popupFeatures, CefWindowInfo &windowInfo,
 			   CefRefPtr<CefClient> &client, CefBrowserSettings &settings, CefRefPtr<CefDictionaryValue> &extra_info, bool *no_javascript_access) override;
 
+	void OnAfterCreated(CefRefPtr<CefBrowser> browser) override;
+	void OnBeforeClose(CefRefPtr<CefBrowser> browser) override;
+
 	bool OnTooltip(CefRefPtr<CefBrowser> browser, CefString &text) override;
 	bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefProcessId source_process, CefRefPtr<CefProcessMessage> message) override;
 
@@ -69,20 +83,64 @@ public:
 
 public:
 	CefRefPtr<CefBrowser> GetMostRecentRenderKnown();
-	CefRefPtr<CefBrowser> PopCallback(const int functionId);
-	void RegisterCallback(const int functionId, CefRefPtr<CefBrowser> browser);
+
+	// By CefBrowser::GetIdentifier, nullptr once it's closed
+	CefRefPtr<CefBrowser> GetBrowser(const int identifier);
+	// callbackId is what the plugin knows the request by, the renderer's own id goes back in the executeCallback message
+	CefRefPtr<CefBrowser> PopCallback(const int callbackId, int &out_rendererCallbackId);
+
+	// 0 when too many are pending
+	int RegisterCallback(const int rendererCallbackId, CefRefPtr<CefBrowser> browser, const JavascriptApi::JSFuncs funcId);
+	void CancelCallbacks(CefRefPtr<CefBrowser> browser);
+
+	// { "pending": 0, "peak_pending": 0, "expired": 0, "rejected": 0 }
+	json11::Json GetCallbackStats() const { return m_callbacks.stats(); }
+
+	// Returns what the browser is subscribed to afterwards, an empty names list means every event
+	std::vector<std::string> SubscribeEvents(CefRefPtr<CefBrowser> browser, const std::vector<std::string> &names);
+	std::vector<std::string> UnsubscribeEvents(CefRefPtr<CefBrowser> browser, const std::vector<std::string> &names);
+	void ClearEventSubscriptions(CefRefPtr<CefBrowser> browser);
+
+	// From the plugin's event stream, forwarded to every subscribed page
+	void DispatchObsEvent(const std::string &name, const std::string &jsonStr);
 
 public:
 	static std::string cefListValueToJSONString(CefRefPtr<CefListValue> listValue);
 
+	// Fills the typed args of the hot calls, false for anything else or if the values don't fit
+	static bool cefListValueToTypedArgs(const JavascriptApi::JSFuncs funcId, CefRefPtr<CefListValue> listValue, grpc_js_api_Request &request);
+
 private:
 	void UpdateExtraTexture();
 	bool valid() const;
 
+	// Cancels whatever the plugin never answered in time
+	void ExpireCallbacks();
+
 	bool m_reroute_audio = true;
 
 	std::recursive_mutex m_recursiveMutex;
-	std::map<int, CefRefPtr<CefBrowser>> m_callbackDictionary;
+
+	struct PendingCallback
+	{
+		CefRefPtr<CefBrowser> browser;
+		int rendererCallbackId = 0;
+	};
+
+	// Ids are handed out here rather than taken from the renderer, every renderer process counts from 1
+	GenerationalSlotTable<PendingCallback> m_callbacks;
+
+	struct EventSubscription
+	{
+		CefRefPtr<CefBrowser> browser;
+		std::set<std::string> names;
+	};
+
+	// By browser identifier
+	std::map<int, EventSubscription> m_eventSubscriptions;
+
+	// Every open browser by identifier, from OnAfterCreated until OnBeforeClose
+	std::unordered_map<int, CefRefPtr<CefBrowser>> m_browsers;
 
 	CefRefPtr<CefBrowser> m_Browser;
 	CefRefPtr<CefBrowser> m_MostRecentRenderKnowOf = nullptr;
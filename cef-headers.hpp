@@ -29,6 +29,20 @@
 #define ENABLE_WASHIDDEN 0
 #endif
 
+// CefV8Value::CreatePromise, ResolvePromise and RejectPromise
+#if CHROME_VERSION_BUILD >= 4844
+#define ENABLE_V8_PROMISES 1
+#else
+#define ENABLE_V8_PROMISES 0
+#endif
+
+// CefV8Value::GetArrayBufferData and GetArrayBufferByteLength
+#if CHROME_VERSION_BUILD >= 5615
+#define ENABLE_V8_ARRAYBUFFER_DATA 1
+#else
+#define ENABLE_V8_ARRAYBUFFER_DATA 0
+#endif
+
 #define SendBrowserProcessMessage(browser, pid, msg)             \
 	CefRefPtr<CefFrame> mainFrame = browser->GetMainFrame(); \
 	if (mainFrame)                                           \
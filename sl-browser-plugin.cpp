@@ -10,11 +10,14 @@
 #include <filesystem>
 
 #include "GrpcPlugin.h"
+#include "IpcEndpoint.h"
+#include "ObsEventStream.h"
 #include "PluginJsHandler.h"
 #include "WebServer.h"
 #include "ConsoleToggle.h"
 #include "CrashHandler.h"
 #include "QtGuiModifications.h"
+#include "SourceQueryCache.h"
 
 #include <QMainWindow>
 #include <QMenuBar>
@@ -116,9 +119,12 @@ void obs_module_post_load(void)
 
 	QtGuiModifications::instance();
 	PluginJsHandler::instance().start();
+	SourceQueryCache::instance().connect();
+	ObsEventStream::instance().connect();
 
 	obs_frontend_add_event_callback(PluginJsHandler::instance().handle_obs_frontend_event, nullptr);
 	obs_frontend_add_event_callback(QtGuiModifications::instance().handle_obs_frontend_event, nullptr);
+	obs_frontend_add_event_callback(ObsEventStream::instance().handle_obs_frontend_event, nullptr);
 
 	auto chooseProxyPort = []() {
 		int32_t result = 0;
@@ -146,17 +152,52 @@ void obs_module_post_load(void)
 		return result;
 	};
 
+	// SL_BROWSER_IPC_TRANSPORT=unix puts both servers on unix domain sockets, nothing to race for and no tcp stack in between
+	auto chooseUnixAddresses = [](std::string &out_myAddress, std::string &out_targetAddress) {
+		char buffer[MAX_PATH];
+		DWORD len = GetEnvironmentVariableA("SL_BROWSER_IPC_TRANSPORT", buffer, MAX_PATH);
+
+		if (len == 0 || len >= MAX_PATH || std::string(buffer) != "unix")
+			return false;
+
+		len = GetTempPathA(MAX_PATH, buffer);
+
+		if (len == 0 || len >= MAX_PATH)
+			return false;
+
+		const std::string prefix = "sl-browser-" + std::to_string(GetCurrentProcessId());
+		out_myAddress = IpcEndpoint::unixSocket(buffer, prefix + "-plugin.sock");
+		out_targetAddress = IpcEndpoint::unixSocket(buffer, prefix + "-browser.sock");
+		return !out_myAddress.empty() && !out_targetAddress.empty();
+	};
+
 	bool browserGood = false;
-	int32_t myListenPort = chooseProxyPort();
-	int32_t targetListenPort = chooseProxyPort();
+	bool serverGood = false;
+	std::string myAddress;
+	std::string targetAddress;
+
+	if (chooseUnixAddresses(myAddress, targetAddress))
+	{
+		serverGood = GrpcPlugin::instance().startServer(myAddress);
+
+		if (!serverGood)
+			blog(LOG_WARNING, "%s: Failed to listen on %s, falling back to tcp", obs_module_description(), myAddress.c_str());
+	}
+
+	if (!serverGood)
+	{
+		myAddress = IpcEndpoint::tcp(chooseProxyPort());
+		targetAddress = IpcEndpoint::tcp(chooseProxyPort());
+		serverGood = GrpcPlugin::instance().startServer(myAddress);
+	}
  
-	blog(LOG_INFO, "%s: Sending %d and %d to proxy", obs_module_description(), myListenPort, targetListenPort);
+	blog(LOG_INFO, "%s: Sending %s and %s to proxy", obs_module_description(), myAddress.c_str(), targetAddress.c_str());
 
 	STARTUPINFOW si;
 	memset(&si, NULL, sizeof(si));
 	si.cb = sizeof(si);
 
-	if (GrpcPlugin::instance().startServer(myListenPort))
+	if (serverGood)
 	{
 		try
 		{
@@ -167,7 +208,7 @@ void obs_module_post_load(void)
 				return;
 			blog(LOG_ERROR, "[SL_PLUGIN]: obs_module_post_load Module path: %s", absolute_path);
 			std::wstring process_path = std::filesystem::u8path(absolute_path).remove_filename().wstring() + L"/sl-browser.exe";
-			std::wstring startparams = L"sl-browser " + std::to_wstring(GetCurrentProcessId()) + L" " + std::to_wstring(myListenPort) + L" " + std::to_wstring(targetListenPort);
+			std::wstring startparams = L"sl-browser " + std::to_wstring(GetCurrentProcessId()) + L" " + std::wstring(myAddress.begin(), myAddress.end()) + L" " + std::wstring(targetAddress.begin(), targetAddress.end());
 			blog(LOG_ERROR, "[SL_PLUGIN]: obs_module_post_load process_path: %s", process_path.c_str());
 			blog(LOG_ERROR, "[SL_PLUGIN]: obs_module_post_load startparams: %s", startparams.c_str());
 			browserGood = CreateProcessW(process_path.c_str(), (LPWSTR)startparams.c_str(), NULL, NULL, FALSE, CREATE_NEW_CONSOLE, NULL, NULL, &si, &g_browserProcessInfo);
@@ -177,7 +218,7 @@ void obs_module_post_load(void)
 			blog(LOG_ERROR, "%s: obs_module_post_load catch while launching server", obs_module_description());
 		}
 
-		if (browserGood && !GrpcPlugin::instance().connectToClient(targetListenPort))
+		if (browserGood && !GrpcPlugin::instance().connectToClient(targetAddress))
 		{
 			browserGood = FALSE;
 			blog(LOG_ERROR, "%s: obs_module_post_load can't connect to process, GetLastError = %d", obs_module_description(), GetLastError());
@@ -221,6 +262,8 @@ void obs_module_unload(void)
 	::CloseHandle(g_browserProcessInfo.hThread);
 
 	// JS handler needs to be stopped before Grpc or crash
+	SourceQueryCache::instance().disconnect();
+	ObsEventStream::instance().disconnect();
 	PluginJsHandler::instance().stop();
 	GrpcPlugin::instance().stop();
 	WebServer::instance().stop();
@@ -0,0 +1,1021 @@
+// In-process benchmarks for the plugin's request dispatch, the parts of PluginJsHandler that build without OBS or Qt
+// Each suite also runs what the code replaced, so one run gives the before and after numbers
+//
+//   queue: push -> execute latency through PriorityLane under bursts, against the 1ms polling loop it replaced
+//   lanes: a mix of file, read and mutating calls through the mutate/read/IO lanes, against one thread running them in order
+//   lookup: JavascriptApi's name lookups against the std::map copied on every call they replaced
+//   binder: obs_sceneitem_set_pos from the renderer's arguments to the handler's locals, typed grpc args against the param1..N JSON
+//   offmain: a scene item getter read on the worker under the scene's lock, against the blocking hop to a mock main thread, with the UI idle and busy
+
+#include "JsArgBinder.h"
+#include "PriorityLane.h"
+#include "sl_browser_api.pb.h"
+
+#include <json11/json11.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace json11;
+
+namespace {
+
+struct Options
+{
+	std::string suite = "all";
+	int requests = 20000;
+	int burst = 64;
+	bool json = false;
+};
+
+Options g_options;
+
+// Every operator new in the process, so allocs_per_request compares variants rather than counting only our code
+std::atomic<uint64_t> g_allocations{0};
+
+uint64_t nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double processCpuMs()
+{
+	timespec ts = {};
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return double(ts.tv_sec) * 1000.0 + double(ts.tv_nsec) / 1000000.0;
+}
+
+Json percentiles(std::vector<double> &samples)
+{
+	std::sort(samples.begin(), samples.end());
+
+	auto percentile = [&samples](const double p) { return samples.empty() ? 0.0 : samples[std::min(samples.size() - 1, size_t(p * double(samples.size())))]; };
+
+	return Json::object{{"p50", percentile(0.50)}, {"p90", percentile(0.90)}, {"p99", percentile(0.99)}, {"max", samples.empty() ? 0.0 : samples.back()}};
+}
+
+// Long enough to leave the small string buffer, like most real params
+std::string makeParams(const int i)
+{
+	return "{\"param1\":" + std::to_string(i) + ",\"param2\":\"Scene\",\"param3\":\"Source " + std::to_string(i % 100) + "\"}";
+}
+
+/***
+* queue
+* One producer pushes bursts, one worker executes them and records how long each waited
+*/
+
+struct QueuedRequest
+{
+	std::string funcName;
+	std::string params;
+	uint64_t pushedNs = 0;
+};
+
+// PluginJsHandler::workerThread before the lanes, the whole vector swapped out every millisecond and the caller's strings copied in
+class PollingQueue
+{
+public:
+	void push(const std::string &funcName, const std::string &params, const uint64_t pushedNs)
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+		m_requests.push_back({funcName, params, pushedNs});
+	}
+
+	template<typename Execute> void run(const std::atomic<bool> &running, const Execute &execute)
+	{
+		while (running)
+		{
+			std::vector<QueuedRequest> latestBatch;
+
+			{
+				std::lock_guard<std::mutex> grd(m_mtx);
+				latestBatch.swap(m_requests);
+			}
+
+			if (latestBatch.empty())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+
+			for (auto &request : latestBatch)
+				execute(request);
+		}
+	}
+
+	void wake() {}
+
+private:
+	std::mutex m_mtx;
+	std::vector<QueuedRequest> m_requests;
+};
+
+// What the plugin runs now, moved in and woken on push
+class LaneQueue
+{
+public:
+	void push(std::string funcName, std::string params, const uint64_t pushedNs)
+	{
+		m_lane.push(JavascriptApi::JS_PRIORITY_NORMAL, {std::move(funcName), std::move(params), pushedNs});
+	}
+
+	template<typename Execute> void run(const std::atomic<bool> &running, const Execute &execute)
+	{
+		QueuedRequest request;
+
+		while (m_lane.pop(request, [&running] { return !running; }, [] { return false; }))
+			execute(request);
+	}
+
+	void wake()
+	{
+		{
+			std::lock_guard<std::mutex> grd(m_lane.mtx);
+		}
+
+		m_lane.cv.notify_all();
+	}
+
+private:
+	PriorityLane<QueuedRequest> m_lane;
+};
+
+template<typename Queue> Json runQueueVariant()
+{
+	Queue queue;
+	std::atomic<bool> running{true};
+	std::atomic<int> executed{0};
+	std::vector<double> waitUs;
+	waitUs.reserve(size_t(g_options.requests));
+
+	std::thread worker([&] {
+		queue.run(running, [&](const QueuedRequest &request) {
+			waitUs.push_back(double(nowNs() - request.pushedNs) / 1000.0);
+			++executed;
+		});
+	});
+
+	// Idle first, what an OBS with no page making calls pays
+	const double idleCpuStart = processCpuMs();
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	const double idleCpuMs = (processCpuMs() - idleCpuStart) * 2.0;
+
+	std::minstd_rand random(42);
+	const uint64_t allocationsStart = g_allocations;
+	const uint64_t start = nowNs();
+
+	for (int pushed = 0; pushed < g_options.requests;)
+	{
+		for (int i = 0; i < g_options.burst && pushed < g_options.requests; ++i, ++pushed)
+			queue.push("obs_sceneitem_get_pos", makeParams(pushed), nowNs());
+
+		// Pages send in bursts (a dock loading, a scene switch) with gaps between
+		std::this_thread::sleep_for(std::chrono::microseconds(random() % 2000));
+	}
+
+	while (executed < g_options.requests)
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+	const double seconds = double(nowNs() - start) / 1000000000.0;
+	const uint64_t allocations = g_allocations - allocationsStart;
+
+	running = false;
+	queue.wake();
+	worker.join();
+
+	return Json::object{{"requests", double(g_options.requests)},
+			    {"seconds", seconds},
+			    {"wait_us", percentiles(waitUs)},
+			    {"allocs_per_request", double(allocations) / double(g_options.requests)},
+			    {"idle_cpu_ms_per_sec", idleCpuMs}};
+}
+
+Json runQueue()
+{
+	return Json::object{{"polling", runQueueVariant<PollingQueue>()}, {"lane", runQueueVariant<LaneQueue>()}};
+}
+
+/***
+* lanes
+* The plugin's classification and thread counts, with the handlers replaced by sleeps (IO) and spins (OBS work)
+*/
+
+struct LaneRequest
+{
+	JavascriptApi::JSFuncClass funcClass = JavascriptApi::JS_CLASS_MUTATE;
+	uint64_t mutationTicket = 0;
+	uint64_t pushedNs = 0;
+};
+
+void spinFor(const uint64_t ns)
+{
+	const uint64_t until = nowNs() + ns;
+
+	while (nowNs() < until)
+		;
+}
+
+void runHandler(const JavascriptApi::JSFuncClass funcClass)
+{
+	switch (funcClass)
+	{
+	case JavascriptApi::JS_CLASS_IO:
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		break;
+	default:
+		spinFor(20000);
+		break;
+	}
+}
+
+class LaneResults
+{
+public:
+	void record(const LaneRequest &request)
+	{
+		const double us = double(nowNs() - request.pushedNs) / 1000.0;
+
+		std::lock_guard<std::mutex> grd(m_mtx);
+		m_latencyUs[request.funcClass].push_back(us);
+		++m_done;
+	}
+
+	int done()
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+		return m_done;
+	}
+
+	Json latency(const JavascriptApi::JSFuncClass funcClass) { return percentiles(m_latencyUs[funcClass]); }
+
+private:
+	std::mutex m_mtx;
+	std::vector<double> m_latencyUs[JavascriptApi::JS_CLASS_IO + 1];
+	int m_done = 0;
+};
+
+// PluginJsHandler::workerThread before the lanes, one thread running everything in the order it arrived
+class SerialExecutor
+{
+public:
+	explicit SerialExecutor(LaneResults &results) : m_results(results)
+	{
+		m_lane.threads.emplace_back([this] {
+			LaneRequest request;
+
+			while (m_lane.pop(request, [this] { return !m_running; }, [] { return false; }))
+			{
+				runHandler(request.funcClass);
+				m_results.record(request);
+			}
+		});
+	}
+
+	~SerialExecutor()
+	{
+		{
+			std::lock_guard<std::mutex> grd(m_lane.mtx);
+			m_running = false;
+		}
+
+		m_lane.cv.notify_all();
+		m_lane.threads.front().join();
+	}
+
+	void push(const JavascriptApi::JSFuncs funcId)
+	{
+		m_lane.push(JavascriptApi::JS_PRIORITY_NORMAL, {JavascriptApi::getFunctionClass(funcId), 0, nowNs()});
+	}
+
+private:
+	LaneResults &m_results;
+	PriorityLane<LaneRequest> m_lane;
+	std::atomic<bool> m_running{true};
+};
+
+// PluginJsHandler's lanes, reads wait for every mutation sent before them the same way
+class LaneExecutor
+{
+public:
+	explicit LaneExecutor(LaneResults &results) : m_results(results)
+	{
+		startThreads(m_mutateLane, 1);
+		startThreads(m_readLane, 4);
+		startThreads(m_ioLane, 2);
+	}
+
+	~LaneExecutor()
+	{
+		m_running = false;
+
+		for (auto *lane : {&m_mutateLane, &m_readLane, &m_ioLane})
+		{
+			{
+				std::lock_guard<std::mutex> grd(lane->mtx);
+			}
+
+			lane->cv.notify_all();
+		}
+
+		{
+			std::lock_guard<std::mutex> grd(m_mutationsMtx);
+		}
+
+		m_mutationsCv.notify_all();
+
+		for (auto *lane : {&m_mutateLane, &m_readLane, &m_ioLane})
+		{
+			for (auto &thread : lane->threads)
+				thread.join();
+		}
+	}
+
+	void push(const JavascriptApi::JSFuncs funcId)
+	{
+		const auto funcClass = JavascriptApi::getFunctionClass(funcId);
+		auto &lane = funcClass == JavascriptApi::JS_CLASS_IO ? m_ioLane : funcClass == JavascriptApi::JS_CLASS_READ ? m_readLane : m_mutateLane;
+
+		{
+			std::lock_guard<std::mutex> grd(lane.mtx);
+
+			uint64_t ticket = 0;
+
+			if (funcClass == JavascriptApi::JS_CLASS_MUTATE)
+				ticket = ++m_mutationsQueued;
+			else if (funcClass == JavascriptApi::JS_CLASS_READ)
+				ticket = m_mutationsQueued;
+
+			lane.queues[JavascriptApi::getFunctionPriority(funcId)].push_back({funcClass, ticket, nowNs()});
+		}
+
+		lane.cv.notify_one();
+	}
+
+private:
+	void startThreads(PriorityLane<LaneRequest> &lane, const int count)
+	{
+		for (int i = 0; i < count; ++i)
+			lane.threads.emplace_back([this, &lane] { workerThread(lane); });
+	}
+
+	void workerThread(PriorityLane<LaneRequest> &lane)
+	{
+		LaneRequest request;
+
+		while (lane.pop(request, [this] { return !m_running; }, [] { return false; }))
+		{
+			if (request.funcClass == JavascriptApi::JS_CLASS_READ)
+			{
+				std::unique_lock<std::mutex> lock(m_mutationsMtx);
+				m_mutationsCv.wait(lock, [this, &request] { return m_mutationsDone >= request.mutationTicket || !m_running; });
+			}
+
+			runHandler(request.funcClass);
+
+			// One mutate thread, so they finish in ticket order and the watermark just advances
+			if (request.funcClass == JavascriptApi::JS_CLASS_MUTATE)
+			{
+				{
+					std::lock_guard<std::mutex> grd(m_mutationsMtx);
+					m_mutationsDone = request.mutationTicket;
+				}
+
+				m_mutationsCv.notify_all();
+			}
+
+			m_results.record(request);
+		}
+	}
+
+	LaneResults &m_results;
+	PriorityLane<LaneRequest> m_mutateLane;
+	PriorityLane<LaneRequest> m_readLane;
+	PriorityLane<LaneRequest> m_ioLane;
+
+	std::mutex m_mutationsMtx;
+	std::condition_variable m_mutationsCv;
+	uint64_t m_mutationsQueued = 0;
+	uint64_t m_mutationsDone = 0;
+
+	std::atomic<bool> m_running{true};
+};
+
+template<typename Executor> Json runLanesVariant()
+{
+	// Roughly a dock polling scene state while the user drags items around, plus the odd download or log report
+	const JavascriptApi::JSFuncs mix[] = {JavascriptApi::JS_GET_CURRENT_SCENE, JavascriptApi::JS_QUERY_DOCKS, JavascriptApi::JS_GET_SCENEITEM_POS,
+					      JavascriptApi::JS_SCENE_GET_SOURCES, JavascriptApi::JS_SET_SCENEITEM_POS, JavascriptApi::JS_SET_SCENEITEM_POS};
+
+	LaneResults results;
+	std::minstd_rand random(42);
+	uint64_t start = 0;
+
+	{
+		Executor executor(results);
+		start = nowNs();
+
+		for (int pushed = 0; pushed < g_options.requests;)
+		{
+			for (int i = 0; i < g_options.burst && pushed < g_options.requests; ++i, ++pushed)
+			{
+				if (random() % 50 == 0)
+					executor.push(random() % 2 ? JavascriptApi::JS_DOWNLOAD_ZIP : JavascriptApi::JS_GET_LOGS_REPORT_STRING);
+				else
+					executor.push(mix[random() % (sizeof(mix) / sizeof(mix[0]))]);
+			}
+
+			std::this_thread::sleep_for(std::chrono::microseconds(random() % 2000));
+		}
+
+		while (results.done() < g_options.requests)
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	const double seconds = double(nowNs() - start) / 1000000000.0;
+
+	return Json::object{{"requests", double(g_options.requests)},
+			    {"seconds", seconds},
+			    {"requests_per_sec", double(g_options.requests) / seconds},
+			    {"mutate_us", results.latency(JavascriptApi::JS_CLASS_MUTATE)},
+			    {"read_us", results.latency(JavascriptApi::JS_CLASS_READ)},
+			    {"io_us", results.latency(JavascriptApi::JS_CLASS_IO)}};
+}
+
+Json runLanes()
+{
+	return Json::object{{"serial", runLanesVariant<SerialExecutor>()}, {"lanes", runLanesVariant<LaneExecutor>()}};
+}
+
+/***
+* lookup
+* Every name in both tables plus a miss, the same order for each variant
+*/
+
+// JavascriptApi before the constexpr tables, a static map per side copied out by every lookup
+class MapCopyLookup
+{
+public:
+	MapCopyLookup()
+	{
+		for (auto &entry : JavascriptApi::getPluginFunctionNames())
+			m_pluginNames[std::string(entry.name)] = entry.id;
+
+		for (auto &entry : JavascriptApi::getBrowserFunctionNames())
+			m_browserNames[std::string(entry.name)] = entry.id;
+	}
+
+	std::map<std::string, JavascriptApi::JSFuncs> &getPluginFunctionNames() { return m_pluginNames; }
+	std::map<std::string, JavascriptApi::JSFuncs> &getBrowserFunctionNames() { return m_browserNames; }
+
+	bool isValidFunctionName(const std::string &str) { return isPluginFunctionName(str) || isBrowserFunctionName(str); }
+
+	bool isPluginFunctionName(const std::string &str)
+	{
+		auto ref = getPluginFunctionNames();
+		return ref.find(str) != ref.end();
+	}
+
+	bool isBrowserFunctionName(const std::string &str)
+	{
+		auto ref = getBrowserFunctionNames();
+		return ref.find(str) != ref.end();
+	}
+
+	JavascriptApi::JSFuncs getFunctionId(const std::string &funcName)
+	{
+		auto ref = getPluginFunctionNames();
+		auto itr = ref.find(funcName);
+
+		if (itr != ref.end())
+			return itr->second;
+
+		ref = getBrowserFunctionNames();
+		itr = ref.find(funcName);
+
+		if (itr != ref.end())
+			return itr->second;
+
+		return JavascriptApi::JS_INVALID;
+	}
+
+private:
+	std::map<std::string, JavascriptApi::JSFuncs> m_pluginNames;
+	std::map<std::string, JavascriptApi::JSFuncs> m_browserNames;
+};
+
+// What the plugin and renderer call now
+struct TableLookup
+{
+	bool isValidFunctionName(const std::string &str) { return JavascriptApi::isValidFunctionName(str); }
+	JavascriptApi::JSFuncs getFunctionId(const std::string &funcName) { return JavascriptApi::getFunctionId(funcName); }
+};
+
+template<typename Lookup> Json runLookupVariant(const std::vector<std::string> &names)
+{
+	Lookup lookup;
+	uint64_t found = 0;
+
+	auto timeLookups = [&](const auto &call) {
+		const uint64_t allocationsStart = g_allocations;
+		const uint64_t start = nowNs();
+
+		for (int i = 0; i < g_options.requests; ++i)
+			found += call(names[size_t(i) % names.size()]);
+
+		const double ns = double(nowNs() - start) / double(g_options.requests);
+		return Json::object{{"ns_per_lookup", ns}, {"allocs_per_lookup", double(g_allocations - allocationsStart) / double(g_options.requests)}};
+	};
+
+	Json::object result;
+	result["getFunctionId"] = timeLookups([&lookup](const std::string &name) { return lookup.getFunctionId(name) != JavascriptApi::JS_INVALID; });
+	result["isValidFunctionName"] = timeLookups([&lookup](const std::string &name) { return lookup.isValidFunctionName(name); });
+
+	// Both variants have to agree, otherwise the numbers compare different work
+	result["found"] = double(found);
+	return result;
+}
+
+Json runLookup()
+{
+	std::vector<std::string> names;
+
+	for (auto &entry : JavascriptApi::getPluginFunctionNames())
+		names.emplace_back(entry.name);
+
+	for (auto &entry : JavascriptApi::getBrowserFunctionNames())
+		names.emplace_back(entry.name);
+
+	names.emplace_back("obs_not_a_function");
+
+	std::shuffle(names.begin(), names.end(), std::minstd_rand(42));
+
+	return Json::object{{"names", double(names.size())}, {"map_copy", runLookupVariant<MapCopyLookup>(names)}, {"table", runLookupVariant<TableLookup>(names)}};
+}
+
+/***
+* binder
+* Both ends of one obs_sceneitem_set_pos, everything between the page's arguments and the handler's locals except the transport itself
+*/
+
+// The parts of PluginJsHandler::TypedArgs setSceneItemPos reads
+struct SetPosArgs
+{
+	std::string scene_name;
+	std::string source_name;
+	float x = 0;
+	float y = 0;
+};
+
+// BrowserClient::cefListValueToJSONString, then GrpcPlugin's js_api handler, executeApiRequest's parse and JS_SET_SCENEITEM_POS's bindArgs
+bool jsonSetPos(const int callbackId, const std::string &scene, const std::string &item, const double x, const double y, SetPosArgs &out, size_t &out_wireBytes)
+{
+	std::string wire;
+
+	{
+		std::map<std::string, Json> jsonMap;
+		jsonMap["param1"] = callbackId;
+		jsonMap["param2"] = scene;
+		jsonMap["param3"] = item;
+		jsonMap["param4"] = x;
+		jsonMap["param5"] = y;
+
+		grpc_js_api_Request request;
+		request.set_funcname("obs_sceneitem_set_pos");
+		request.set_callbackid(callbackId);
+		request.set_params(Json(jsonMap).dump());
+		request.SerializeToString(&wire);
+	}
+
+	out_wireBytes = wire.size();
+
+	grpc_js_api_Request request;
+
+	if (!request.ParseFromString(wire))
+		return false;
+
+	std::string err;
+	const Json params = Json::parse(request.params(), err);
+
+	if (!err.empty())
+		return false;
+
+	std::string jsonReturn;
+	return JsArgBinder::bindArgs(params, jsonReturn, out.scene_name, out.source_name, out.x, out.y);
+}
+
+// BrowserClient::cefListValueToTypedArgs, then GrpcPlugin's js_api handler filling TypedArgs
+bool typedSetPos(const int callbackId, const std::string &scene, const std::string &item, const double x, const double y, SetPosArgs &out, size_t &out_wireBytes)
+{
+	std::string wire;
+
+	{
+		grpc_js_api_Request request;
+		request.set_funcname("obs_sceneitem_set_pos");
+		request.set_callbackid(callbackId);
+
+		grpc_typed_SceneItemTransform *transform = request.mutable_sceneitem_transform();
+		transform->set_scene(scene);
+		transform->set_item(item);
+		transform->mutable_pos()->set_x(float(x));
+		transform->mutable_pos()->set_y(float(y));
+		request.SerializeToString(&wire);
+	}
+
+	out_wireBytes = wire.size();
+
+	grpc_js_api_Request request;
+
+	if (!request.ParseFromString(wire) || request.args_case() != grpc_js_api_Request::kSceneitemTransform)
+		return false;
+
+	auto &transform = *request.mutable_sceneitem_transform();
+	out.scene_name = std::move(*transform.mutable_scene());
+	out.source_name = std::move(*transform.mutable_item());
+	out.x = transform.pos().x();
+	out.y = transform.pos().y();
+	return true;
+}
+
+template<typename SetPos> Json runBinderVariant(const SetPos &setPos)
+{
+	// Names past the small string buffer, as OBS's defaults ("Video Capture Device 2") usually are
+	const std::string scene = "Gameplay Scene";
+	const std::string item = "Video Capture Device 2";
+
+	size_t wireBytes = 0;
+	int errors = 0;
+
+	const uint64_t allocationsStart = g_allocations;
+	const uint64_t start = nowNs();
+
+	for (int i = 0; i < g_options.requests; ++i)
+	{
+		SetPosArgs args;
+
+		if (!setPos(i + 1, scene, item, double(i % 1920), 540.5, args, wireBytes) || args.source_name != item || args.x != float(i % 1920) || args.y != 540.5f)
+			++errors;
+	}
+
+	const double ns = double(nowNs() - start) / double(g_options.requests);
+
+	return Json::object{{"ns_per_call", ns},
+			    {"allocs_per_call", double(g_allocations - allocationsStart) / double(g_options.requests)},
+			    {"wire_bytes", double(wireBytes)},
+			    {"errors", errors}};
+}
+
+Json runBinder()
+{
+	return Json::object{{"json", runBinderVariant(jsonSetPos)}, {"typed", runBinderVariant(typedSetPos)}};
+}
+
+/***
+* offmain
+* A mock Qt main thread and a mock libobs scene, the graphics thread takes the scene's lock once a frame like obs_scene's render does
+*/
+
+// Stands in for the main window's event loop, busy frames model a UI that is painting, resizing docks or running a slow slot
+class MockMainThread
+{
+public:
+	explicit MockMainThread(const bool busy) : m_busy(busy), m_thread([this] { run(); }) {}
+
+	~MockMainThread()
+	{
+		{
+			std::lock_guard<std::mutex> grd(m_mtx);
+			m_running = false;
+		}
+
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+	// Qt::BlockingQueuedConnection, what runOnMainThread does
+	void runBlocking(const std::function<void()> &task)
+	{
+		std::mutex doneMtx;
+		std::condition_variable doneCv;
+		bool done = false;
+
+		{
+			std::lock_guard<std::mutex> grd(m_mtx);
+			m_tasks.push_back([&] {
+				task();
+
+				std::lock_guard<std::mutex> doneGrd(doneMtx);
+				done = true;
+				doneCv.notify_one();
+			});
+		}
+
+		m_cv.notify_one();
+
+		std::unique_lock<std::mutex> lock(doneMtx);
+		doneCv.wait(lock, [&done] { return done; });
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mtx);
+
+		while (m_running)
+		{
+			if (m_busy)
+			{
+				// Queued calls only run between events, a busy UI hands them the thread once per frame
+				lock.unlock();
+				spinFor(8000000);
+				lock.lock();
+			}
+			else
+			{
+				m_cv.wait(lock, [this] { return !m_tasks.empty() || !m_running; });
+			}
+
+			auto tasks = std::move(m_tasks);
+			m_tasks.clear();
+			lock.unlock();
+
+			for (auto &task : tasks)
+				task();
+
+			lock.lock();
+		}
+	}
+
+	const bool m_busy;
+	std::mutex m_mtx;
+	std::condition_variable m_cv;
+	std::vector<std::function<void()>> m_tasks;
+	bool m_running = true;
+
+	// Last, it starts running in the constructor
+	std::thread m_thread;
+};
+
+// obs_scene_t's mutex and one item, what readSceneItem holds while it reads
+struct MockScene
+{
+	std::mutex mtx;
+	float x = 100;
+	float y = 200;
+};
+
+Json runOffMainVariant(const bool busy)
+{
+	MockScene scene;
+	MockMainThread mainThread(busy);
+	std::atomic<bool> running{true};
+
+	// 60 fps, the render pass holds the scene's lock for a fraction of each frame
+	std::thread graphicsThread([&] {
+		while (running)
+		{
+			{
+				std::lock_guard<std::mutex> grd(scene.mtx);
+				spinFor(200000);
+			}
+
+			std::this_thread::sleep_for(std::chrono::microseconds(16600));
+		}
+	});
+
+	auto readItem = [&scene](std::string &out_jsonReturn) {
+		std::lock_guard<std::mutex> grd(scene.mtx);
+		out_jsonReturn = Json(Json::object({{"x", scene.x}, {"y", scene.y}})).dump();
+	};
+
+	// A busy main thread makes every hop wait up to a frame, cap the count so the run stays short
+	const int calls = std::min(g_options.requests, 1000);
+
+	auto timeCalls = [&](const auto &call) {
+		std::vector<double> us;
+		us.reserve(size_t(calls));
+
+		for (int i = 0; i < calls; ++i)
+		{
+			std::string jsonReturn;
+			const uint64_t start = nowNs();
+			call(jsonReturn);
+			us.push_back(double(nowNs() - start) / 1000.0);
+
+			// Spread the calls over the graphics thread's frames
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+		}
+
+		return percentiles(us);
+	};
+
+	Json::object result;
+	result["hop_us"] = timeCalls([&](std::string &out_jsonReturn) { mainThread.runBlocking([&] { readItem(out_jsonReturn); }); });
+	result["direct_us"] = timeCalls(readItem);
+
+	running = false;
+	graphicsThread.join();
+	return result;
+}
+
+Json runOffMain()
+{
+	return Json::object{{"idle_ui", runOffMainVariant(false)}, {"busy_ui", runOffMainVariant(true)}};
+}
+
+void printUsage()
+{
+	printf("usage: sl-browser-dispatch-bench [options]\n"
+	       "  --suite <name>           all, queue, lanes, lookup, binder or offmain, default all\n"
+	       "  --requests <n>           timed requests per variant, default 20000\n"
+	       "  --burst <n>              requests pushed back to back, default 64\n"
+	       "  --json                   one line of json instead of the table\n");
+}
+
+bool parseArgs(int argc, char **argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		auto next = [&]() {
+			++i;
+			return value != nullptr;
+		};
+
+		if (arg == "--suite" && next())
+			g_options.suite = value;
+		else if (arg == "--requests" && next())
+			g_options.requests = atoi(value);
+		else if (arg == "--burst" && next())
+			g_options.burst = atoi(value);
+		else if (arg == "--json")
+			g_options.json = true;
+		else
+			return false;
+	}
+
+	for (const char *suite : {"all", "queue", "lanes", "lookup", "binder", "offmain"})
+	{
+		if (g_options.suite == suite)
+			return g_options.requests > 0 && g_options.burst > 0;
+	}
+
+	return false;
+}
+
+void printLatency(const char *name, const Json &result, const char *key)
+{
+	const Json &latency = result[key];
+	printf("  %-18s p50 %9.1f  p90 %9.1f  p99 %9.1f  max %9.1f us\n", name, latency["p50"].number_value(), latency["p90"].number_value(),
+	       latency["p99"].number_value(), latency["max"].number_value());
+}
+
+void printQueue(const Json &result)
+{
+	printf("queue: push -> execute, %d requests in bursts of %d\n", g_options.requests, g_options.burst);
+
+	for (const char *variant : {"polling", "lane"})
+	{
+		printLatency(variant, result[variant], "wait_us");
+		printf("  %-18s %.1f allocs/request, idle %.2f cpu ms/sec\n", "", result[variant]["allocs_per_request"].number_value(),
+		       result[variant]["idle_cpu_ms_per_sec"].number_value());
+	}
+}
+
+void printLanes(const Json &result)
+{
+	printf("lanes: mixed calls, push -> done, %d requests in bursts of %d\n", g_options.requests, g_options.burst);
+
+	for (const char *variant : {"serial", "lanes"})
+	{
+		printf("  %s, %.0f requests/sec\n", variant, result[variant]["requests_per_sec"].number_value());
+		printLatency("mutate", result[variant], "mutate_us");
+		printLatency("read", result[variant], "read_us");
+		printLatency("io", result[variant], "io_us");
+	}
+}
+
+void printLookup(const Json &result)
+{
+	printf("lookup: %d lookups over %.0f names\n", g_options.requests, result["names"].number_value());
+
+	for (const char *variant : {"map_copy", "table"})
+	{
+		for (const char *call : {"getFunctionId", "isValidFunctionName"})
+		{
+			const Json &timing = result[variant][call];
+			printf("  %-9s %-20s %9.1f ns/lookup  %6.1f allocs/lookup\n", variant, call, timing["ns_per_lookup"].number_value(), timing["allocs_per_lookup"].number_value());
+		}
+	}
+}
+
+void printBinder(const Json &result)
+{
+	printf("binder: obs_sceneitem_set_pos, %d calls\n", g_options.requests);
+
+	for (const char *variant : {"json", "typed"})
+	{
+		const Json &timing = result[variant];
+		printf("  %-9s %9.1f ns/call  %6.1f allocs/call  %4.0f wire bytes  %d errors\n", variant, timing["ns_per_call"].number_value(),
+		       timing["allocs_per_call"].number_value(), timing["wire_bytes"].number_value(), timing["errors"].int_value());
+	}
+}
+
+void printOffMain(const Json &result)
+{
+	printf("offmain: scene item getter, %d calls\n", std::min(g_options.requests, 1000));
+
+	for (const char *variant : {"idle_ui", "busy_ui"})
+	{
+		printf("  %s\n", variant);
+		printLatency("main thread hop", result[variant], "hop_us");
+		printLatency("worker direct", result[variant], "direct_us");
+	}
+}
+
+}
+
+void *operator new(size_t size)
+{
+	++g_allocations;
+
+	if (void *result = std::malloc(size != 0 ? size : 1))
+		return result;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+int main(int argc, char **argv)
+{
+	if (!parseArgs(argc, argv))
+	{
+		printUsage();
+		return 2;
+	}
+
+	Json::object results;
+
+	if (g_options.suite == "all" || g_options.suite == "queue")
+		results["queue"] = runQueue();
+
+	if (g_options.suite == "all" || g_options.suite == "lanes")
+		results["lanes"] = runLanes();
+
+	if (g_options.suite == "all" || g_options.suite == "lookup")
+		results["lookup"] = runLookup();
+
+	if (g_options.suite == "all" || g_options.suite == "binder")
+		results["binder"] = runBinder();
+
+	if (g_options.suite == "all" || g_options.suite == "offmain")
+		results["offmain"] = runOffMain();
+
+	if (g_options.json)
+	{
+		printf("%s\n", Json(results).dump().c_str());
+		return 0;
+	}
+
+	if (results.count("queue"))
+		printQueue(results["queue"]);
+
+	if (results.count("lanes"))
+		printLanes(results["lanes"]);
+
+	if (results.count("lookup"))
+		printLookup(results["lookup"]);
+
+	if (results.count("binder"))
+		printBinder(results["binder"]);
+
+	if (results.count("offmain"))
+		printOffMain(results["offmain"]);
+
+	return 0;
+}
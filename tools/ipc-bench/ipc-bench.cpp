@@ -0,0 +1,923 @@
+// Loopback benchmark for the plugin <-> browser grpc layer
+// Hosts grpc_plugin_obj and grpc_proxy_obj the way GrpcPlugin and GrpcBrowser do, in one process or two, and drives synthetic traffic through them
+//
+//   api:        browser js_api -> plugin CallbackOutbox -> executeCallback back to the browser, timed per round trip
+//   javascript: plugin run_javascriptOnBrowser -> browser, one way, throughput only
+//
+// POSIX only (fork, unix sockets), it's meant for the Linux CI box
+
+#include "CallbackOutbox.h"
+#include "IpcCompression.h"
+#include "IpcEndpoint.h"
+#include "IpcPayload.h"
+
+#include <grpcpp/grpcpp.h>
+#include "sl_browser_api.grpc.pb.h"
+
+#include <json11/json11.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace json11;
+
+namespace {
+
+struct Options
+{
+	std::string transport = "tcp";
+	std::string mode = "stream";
+	std::string traffic = "api";
+	size_t payload = 1024;
+	int concurrency = 1;
+	int requests = 10000;
+	int warmup = 100;
+	int processes = 1;
+	bool ring = false;
+	bool compress = false;
+	bool json = false;
+};
+
+Options g_options;
+
+// Renderer callback ids in param1, far from the 1..concurrency grpc callback ids the drivers wait on
+constexpr int kRendererCallbackIdBase = 100000;
+
+// Every operator new in the process, grpc's own included, so allocs_per_msg compares runs rather than counting only our code
+std::atomic<uint64_t> g_allocations{0};
+
+uint64_t nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Same as chooseProxyPort in sl-browser-plugin.cpp
+int32_t chooseTcpPort()
+{
+	int32_t result = 0;
+	int sockt = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (sockt < 0)
+		return result;
+
+	struct sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	local.sin_family = AF_INET;
+	local.sin_port = htons(0);
+
+	if (::bind(sockt, (struct sockaddr *)&local, sizeof(local)) == 0)
+	{
+		socklen_t len = sizeof(local);
+		getsockname(sockt, (struct sockaddr *)&local, &len);
+		result = ntohs(local.sin_port);
+	}
+
+	::close(sockt);
+	return result;
+}
+
+// Shaped like a typical query result so compression sees realistic data, not a run of one character
+std::string makePayload(const size_t size)
+{
+	std::string result = "[";
+
+	for (int i = 0; result.size() < size; ++i)
+		result += "{\"name\":\"Source " + std::to_string(i) + "\",\"id\":" + std::to_string(i * 7919 % 100003) + ",\"visible\":" + (i % 3 ? "true" : "false") + "},";
+
+	result.resize(size);
+	result.back() = ']';
+	return result;
+}
+
+// Seq numbered writes under a lock, like grpc_plugin_objClient and grpc_proxy_objClient
+template<typename Service> class StreamClient
+{
+public:
+	explicit StreamClient(std::shared_ptr<grpc::Channel> channel) : m_stub(Service::NewStub(channel)) {}
+
+	typename Service::Stub &stub() { return *m_stub; }
+
+	bool open()
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+
+		m_context = std::make_unique<grpc::ClientContext>();
+		m_stream = m_stub->com_grpc_stream(m_context.get());
+		m_seq = 0;
+
+		return m_stream != nullptr;
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+
+		if (m_stream == nullptr)
+			return;
+
+		m_stream->WritesDone();
+		m_stream->Finish();
+		m_stream.reset();
+		m_context.reset();
+	}
+
+	bool write(grpc_stream_Message &message)
+	{
+		std::lock_guard<std::mutex> grd(m_mtx);
+
+		if (m_stream == nullptr)
+			return false;
+
+		message.set_seq(++m_seq);
+		return m_stream->Write(message);
+	}
+
+private:
+	std::unique_ptr<typename Service::Stub> m_stub;
+
+	std::mutex m_mtx;
+	std::unique_ptr<grpc::ClientContext> m_context;
+	std::unique_ptr<grpc::ClientReaderWriter<grpc_stream_Message, grpc_stream_Message>> m_stream;
+	uint64_t m_seq = 0;
+};
+
+std::unique_ptr<grpc::Server> startServer(const std::string &address, grpc::Service *service)
+{
+	IpcEndpoint::removeSocketFile(address);
+
+	grpc::ServerBuilder builder;
+	builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+	builder.RegisterService(service);
+	return builder.BuildAndStart();
+}
+
+/***
+* Plugin side
+* Serves grpc_plugin_obj, answers js_api through a CallbackOutbox the way PluginJsHandler does
+*/
+
+class PluginSide final : public grpc_plugin_obj::Service
+{
+public:
+	bool start(const std::string &listenAddress, const std::string &browserAddress)
+	{
+		m_payload = makePayload(g_options.payload);
+
+		if (g_options.ring && !m_ring.create(uint32_t(getpid())))
+		{
+			printf("PluginSide: failed to create payload ring\n");
+			return false;
+		}
+
+		m_server = startServer(listenAddress, this);
+
+		if (m_server == nullptr)
+			return false;
+
+		m_client = std::make_unique<StreamClient<grpc_proxy_obj>>(grpc::CreateChannel(browserAddress, grpc::InsecureChannelCredentials()));
+
+		m_running = true;
+
+		for (int i = 0; i < g_options.concurrency; ++i)
+			m_workers.emplace_back(&PluginSide::workerThread, this);
+
+		m_outbox.start([this](const int functionId, std::string jsonStr) { return deliverCallback(functionId, std::move(jsonStr)); });
+		return true;
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> grd(m_jobMtx);
+			m_running = false;
+		}
+
+		m_jobCv.notify_all();
+
+		for (auto &itr : m_workers)
+			itr.join();
+
+		m_workers.clear();
+		m_outbox.stop();
+
+		if (m_client != nullptr)
+			m_client->close();
+
+		if (m_server != nullptr)
+			m_server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+
+		m_ring.close();
+	}
+
+	Json stats() const { return Json::object{{"callback_outbox", m_outbox.stats()}, {"compression", m_compression.stats()}}; }
+
+	grpc::Status com_grpc_js_api(grpc::ServerContext *context, const grpc_js_api_Request *request, grpc_js_api_Reply *response) override
+	{
+		onJsApi(*request);
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_stream(grpc::ServerContext *context, grpc::ServerReaderWriter<grpc_stream_Message, grpc_stream_Message> *stream) override
+	{
+		grpc_stream_Message message;
+
+		while (stream->Read(&message))
+		{
+			switch (message.payload_case())
+			{
+			case grpc_stream_Message::kJsApi:
+				onJsApi(message.js_api());
+				break;
+			case grpc_stream_Message::kHello:
+				// The browser side opens its stream first, ours back to it waits for that so both directions are up
+				if (g_options.mode == "stream" && !m_client->open())
+					printf("PluginSide: failed to open stream to browser\n");
+				break;
+			default:
+				break;
+			}
+		}
+
+		return grpc::Status::OK;
+	}
+
+private:
+	struct Job
+	{
+		int callbackId = 0;
+		bool javascript = false;
+	};
+
+	void onJsApi(const grpc_js_api_Request &request)
+	{
+		std::lock_guard<std::mutex> grd(m_jobMtx);
+
+		// The kick-off for one way traffic, params carries how many messages to send
+		if (request.funcname() == "bench_run_javascript")
+		{
+			const int count = atoi(request.params().c_str());
+
+			for (int i = 0; i < count; ++i)
+				m_jobs.push_back({0, true});
+		}
+		else
+		{
+			// Like PluginJsHandler::executeApiRequest, param1 has to be there but the result goes back under the grpc callback id
+			std::string err;
+
+			if (Json::parse(request.params(), err)["param1"].is_null())
+			{
+				printf("PluginSide: 'param1' key not found. %s\n", request.params().c_str());
+				return;
+			}
+
+			m_jobs.push_back({request.callbackid(), false});
+		}
+
+		m_jobCv.notify_all();
+	}
+
+	void workerThread()
+	{
+		std::unique_lock<std::mutex> lock(m_jobMtx);
+
+		while (true)
+		{
+			m_jobCv.wait(lock, [this] { return !m_jobs.empty() || !m_running; });
+
+			if (m_jobs.empty())
+				return;
+
+			const Job job = m_jobs.front();
+			m_jobs.pop_front();
+
+			lock.unlock();
+
+			if (job.javascript)
+				sendJavascript();
+			else
+				m_outbox.push(job.callbackId, m_payload);
+
+			lock.lock();
+		}
+	}
+
+	// Mirrors grpc_plugin_objClient::deliverCallback, ring first, then compression, then inline
+	bool deliverCallback(const int functionId, std::string jsonStr)
+	{
+		alignas(8) char arenaBlock[1024];
+		google::protobuf::ArenaOptions arenaOptions;
+		arenaOptions.initial_block = arenaBlock;
+		arenaOptions.initial_block_size = sizeof(arenaBlock);
+		google::protobuf::Arena arena(arenaOptions);
+
+		grpc_stream_Message *message = google::protobuf::Arena::CreateMessage<grpc_stream_Message>(&arena);
+		grpc_js_api_ExecuteCallback &request = *message->mutable_execute_callback();
+		request.set_funcid(functionId);
+
+		uint64_t position = 0;
+		bool inRing = false;
+
+		if (g_options.ring && jsonStr.size() >= IpcPayloadRing::kInlineThreshold && jsonStr.size() <= UINT32_MAX && m_ring.readerAttached())
+			inRing = m_ring.write(jsonStr.data(), jsonStr.size(), position);
+
+		std::string compressed;
+
+		if (inRing)
+		{
+			request.mutable_payload()->set_position(position);
+			request.mutable_payload()->set_length(uint32_t(jsonStr.size()));
+		}
+		else if (g_options.compress && m_compression.shouldCompress(jsonStr.size()) && jsonStr.size() <= UINT32_MAX && m_compression.compress(jsonStr, compressed))
+		{
+			request.set_jsonstr_zlib(std::move(compressed));
+			request.set_original_length(uint32_t(jsonStr.size()));
+		}
+		else
+		{
+			request.set_jsonstr(std::move(jsonStr));
+		}
+
+		if (g_options.mode == "stream")
+		{
+			if (m_client->write(*message))
+				return true;
+
+			if (inRing)
+				m_ring.release(position);
+
+			return false;
+		}
+
+		grpc_js_api_Reply reply;
+		grpc::ClientContext context;
+
+		if (m_client->stub().com_grpc_js_executeCallback(&context, request, &reply).ok())
+			return true;
+
+		if (inRing)
+			m_ring.release(position);
+
+		return false;
+	}
+
+	// Like grpc_plugin_objClient::send_executeJavascript, which takes the script by value
+	void sendJavascript()
+	{
+		grpc_stream_Message message;
+		message.mutable_run_javascript()->set_str(m_payload);
+
+		if (g_options.mode == "stream")
+		{
+			m_client->write(message);
+			return;
+		}
+
+		grpc_empty_Reply reply;
+		grpc::ClientContext context;
+		m_client->stub().com_grpc_run_javascriptOnBrowser(&context, message.run_javascript(), &reply);
+	}
+
+	std::string m_payload;
+
+	std::unique_ptr<grpc::Server> m_server;
+	std::unique_ptr<StreamClient<grpc_proxy_obj>> m_client;
+
+	IpcPayloadRing m_ring;
+	IpcCompression m_compression;
+
+	std::mutex m_jobMtx;
+	std::condition_variable m_jobCv;
+	std::deque<Job> m_jobs;
+	std::vector<std::thread> m_workers;
+	bool m_running = false;
+
+	// Last, its sender thread calls into everything above
+	CallbackOutbox m_outbox;
+};
+
+/***
+* Browser side
+* Serves grpc_proxy_obj, drives the traffic and times it
+*/
+
+class BrowserSide final : public grpc_proxy_obj::Service
+{
+public:
+	bool start(const std::string &listenAddress, const std::string &pluginAddress, const uint32_t pluginPid)
+	{
+		m_server = startServer(listenAddress, this);
+
+		if (m_server == nullptr)
+			return false;
+
+		auto channel = grpc::CreateChannel(pluginAddress, grpc::InsecureChannelCredentials());
+
+		if (!channel->WaitForConnected(std::chrono::system_clock::now() + std::chrono::seconds(10)))
+		{
+			printf("BrowserSide: plugin side never came up at %s\n", pluginAddress.c_str());
+			return false;
+		}
+
+		m_client = std::make_unique<StreamClient<grpc_plugin_obj>>(channel);
+
+		// The plugin creates the ring before its server starts, so it exists by now
+		if (g_options.ring && !m_ring.open(pluginPid))
+		{
+			printf("BrowserSide: failed to open payload ring\n");
+			return false;
+		}
+
+		// Always sent, in unary mode it's only how the plugin side learns we're up
+		grpc_stream_Message hello;
+		hello.mutable_hello()->add_accept_encoding(IpcCompression::kEncoding);
+
+		if (!m_client->open() || !m_client->write(hello))
+		{
+			printf("BrowserSide: failed to open stream to plugin\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	// Ends the plugin side's stream handler, done before either server shuts down so neither waits on the other
+	void disconnect()
+	{
+		if (m_client != nullptr)
+			m_client->close();
+	}
+
+	void stop()
+	{
+		disconnect();
+
+		if (m_server != nullptr)
+			m_server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+
+		m_ring.close();
+	}
+
+	Json runApi()
+	{
+		const int threads = g_options.concurrency;
+		m_slots = std::vector<Slot>(size_t(threads));
+
+		std::vector<std::vector<double>> rtts(m_slots.size());
+		std::atomic<uint64_t> measuredStart = 0;
+		std::atomic<uint64_t> allocationsStart = 0;
+		std::atomic<int> warmedUp = 0;
+
+		std::vector<std::thread> drivers;
+
+		for (int t = 0; t < threads; ++t)
+		{
+			drivers.emplace_back([&, t] {
+				const int count = g_options.requests / threads + (t < g_options.requests % threads ? 1 : 0);
+				const int warmup = g_options.warmup / threads;
+				Slot &slot = m_slots[size_t(t)];
+
+				for (int i = 0; i < warmup + count; ++i)
+				{
+					// Everyone starts timing together, otherwise msgs/sec counts one thread's warmup against another's work
+					if (i == warmup && ++warmedUp == threads)
+					{
+						measuredStart = nowNs();
+						allocationsStart = uint64_t(g_allocations);
+					}
+
+					{
+						std::lock_guard<std::mutex> grd(slot.mtx);
+						slot.done = false;
+					}
+
+					const uint64_t start = nowNs();
+
+					grpc_stream_Message message;
+					grpc_js_api_Request &request = *message.mutable_js_api();
+					request.set_funcname("bench_echo");
+					request.set_callbackid(t + 1);
+					// The untyped envelope cefListValueToJSONString builds. param1 is the renderer's own id, deliberately not the grpc one,
+					// a result routed by it lands outside m_slots and counts as an error
+					request.set_params(Json(Json::object{{"param1", kRendererCallbackIdBase + t}, {"param2", "Scene"}, {"param3", "Source " + std::to_string(i)}}).dump());
+
+					if (!sendJsApi(message))
+					{
+						++m_errors;
+						continue;
+					}
+
+					std::unique_lock<std::mutex> lock(slot.mtx);
+
+					if (!slot.cv.wait_for(lock, std::chrono::seconds(10), [&slot] { return slot.done; }))
+					{
+						++m_errors;
+						continue;
+					}
+
+					if (i >= warmup)
+						rtts[size_t(t)].push_back(double(nowNs() - start) / 1000.0);
+				}
+			});
+		}
+
+		for (auto &itr : drivers)
+			itr.join();
+
+		const uint64_t elapsedNs = nowNs() - measuredStart;
+		const uint64_t allocations = g_allocations - allocationsStart;
+
+		std::vector<double> all;
+
+		for (auto &itr : rtts)
+			all.insert(all.end(), itr.begin(), itr.end());
+
+		std::sort(all.begin(), all.end());
+
+		auto percentile = [&all](const double p) { return all.empty() ? 0.0 : all[std::min(all.size() - 1, size_t(p * double(all.size())))]; };
+
+		Json::object result = summarize(all.size(), elapsedNs, allocations);
+		result["rtt_us"] = Json::object{{"p50", percentile(0.50)}, {"p90", percentile(0.90)}, {"p99", percentile(0.99)}, {"max", all.empty() ? 0.0 : all.back()}};
+		return result;
+	}
+
+	Json runJavascript()
+	{
+		m_javascriptExpected = g_options.requests;
+
+		const uint64_t start = nowNs();
+		const uint64_t allocationsStart = g_allocations;
+
+		grpc_stream_Message message;
+		message.mutable_js_api()->set_funcname("bench_run_javascript");
+		message.mutable_js_api()->set_params(std::to_string(g_options.requests));
+
+		if (!sendJsApi(message))
+			++m_errors;
+
+		{
+			std::unique_lock<std::mutex> lock(m_javascriptMtx);
+
+			if (!m_javascriptCv.wait_for(lock, std::chrono::seconds(60), [this] { return m_javascriptReceived >= m_javascriptExpected; }))
+				++m_errors;
+		}
+
+		return summarize(size_t(m_javascriptReceived), nowNs() - start, g_allocations - allocationsStart);
+	}
+
+	grpc::Status com_grpc_js_executeCallback(grpc::ServerContext *context, const grpc_js_api_ExecuteCallback *request, grpc_js_api_Reply *response) override
+	{
+		executeCallback(*request);
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_run_javascriptOnBrowser(grpc::ServerContext *context, const grpc_run_javascriptOnBrowser *request, grpc_empty_Reply *response) override
+	{
+		runJavascriptOnBrowser(*request);
+		return grpc::Status::OK;
+	}
+
+	grpc::Status com_grpc_stream(grpc::ServerContext *context, grpc::ServerReaderWriter<grpc_stream_Message, grpc_stream_Message> *stream) override
+	{
+		grpc_stream_Message message;
+
+		while (stream->Read(&message))
+		{
+			switch (message.payload_case())
+			{
+			case grpc_stream_Message::kExecuteCallback:
+				executeCallback(message.execute_callback());
+				break;
+			case grpc_stream_Message::kRunJavascript:
+				runJavascriptOnBrowser(message.run_javascript());
+				break;
+			default:
+				break;
+			}
+		}
+
+		return grpc::Status::OK;
+	}
+
+private:
+	struct Slot
+	{
+		std::mutex mtx;
+		std::condition_variable cv;
+		bool done = false;
+	};
+
+	// Built already wrapped, like the requests grpc_proxy_objClient keeps for replay
+	bool sendJsApi(grpc_stream_Message &message)
+	{
+		if (g_options.mode == "stream")
+			return m_client->write(message);
+
+		grpc_js_api_Reply reply;
+		grpc::ClientContext context;
+		return m_client->stub().com_grpc_js_api(&context, message.js_api(), &reply).ok();
+	}
+
+	// Resolves the result exactly like GrpcBrowser's executeCallback, then wakes the driver waiting on it
+	// Only the size is checked, where GrpcBrowser converts to the CefString it sends on
+	void executeCallback(const grpc_js_api_ExecuteCallback &request)
+	{
+		size_t length = 0;
+		bool good = true;
+
+		if (request.has_payload())
+		{
+			good = m_ring.read(request.payload().position(), request.payload().length(), [&length](const char *, const size_t size) { length = size; });
+		}
+		else if (!request.jsonstr_zlib().empty())
+		{
+			std::string jsonStr;
+			good = m_compression.decompress(request.jsonstr_zlib(), request.original_length(), jsonStr);
+			length = jsonStr.size();
+		}
+		else
+		{
+			length = request.jsonstr().size();
+		}
+
+		if (!good || length != g_options.payload)
+			++m_errors;
+
+		const int index = request.funcid() - 1;
+
+		if (index < 0 || index >= int(m_slots.size()))
+		{
+			++m_errors;
+			return;
+		}
+
+		Slot &slot = m_slots[size_t(index)];
+
+		{
+			std::lock_guard<std::mutex> grd(slot.mtx);
+			slot.done = true;
+		}
+
+		slot.cv.notify_one();
+	}
+
+	void runJavascriptOnBrowser(const grpc_run_javascriptOnBrowser &request)
+	{
+		if (request.str().size() != g_options.payload)
+			++m_errors;
+
+		std::lock_guard<std::mutex> grd(m_javascriptMtx);
+
+		if (++m_javascriptReceived >= m_javascriptExpected)
+			m_javascriptCv.notify_one();
+	}
+
+	Json::object summarize(const size_t messages, const uint64_t elapsedNs, const uint64_t allocations) const
+	{
+		const double seconds = double(elapsedNs) / 1000000000.0;
+
+		return Json::object{{"messages", double(messages)},
+				    {"errors", double(m_errors)},
+				    {"seconds", seconds},
+				    {"msgs_per_sec", seconds > 0 ? double(messages) / seconds : 0.0},
+				    {"bytes_per_sec", seconds > 0 ? double(messages) * double(g_options.payload) / seconds : 0.0},
+			    {"allocs_per_msg", messages > 0 ? double(allocations) / double(messages) : 0.0}};
+	}
+
+	std::unique_ptr<grpc::Server> m_server;
+	std::unique_ptr<StreamClient<grpc_plugin_obj>> m_client;
+
+	IpcPayloadRing m_ring;
+	IpcCompression m_compression;
+
+	std::vector<Slot> m_slots;
+	std::atomic<uint64_t> m_errors = 0;
+
+	std::mutex m_javascriptMtx;
+	std::condition_variable m_javascriptCv;
+	int m_javascriptReceived = 0;
+	int m_javascriptExpected = 0;
+};
+
+void printUsage()
+{
+	printf("usage: sl-browser-ipc-bench [options]\n"
+	       "  --transport tcp|unix     default tcp\n"
+	       "  --mode stream|unary      default stream\n"
+	       "  --traffic api|javascript default api, javascript is one way plugin -> browser\n"
+	       "  --payload <bytes>        result / script size, default 1024\n"
+	       "  --concurrency <n>        requests in flight, default 1\n"
+	       "  --requests <n>           timed messages, default 10000\n"
+	       "  --warmup <n>             untimed round trips first, default 100\n"
+	       "  --processes 1|2          plugin and browser side in one process or forked apart, default 1\n"
+	       "  --ring                   results of 64KiB and up go through IpcPayloadRing\n"
+	       "  --compress               zlib above SL_BROWSER_IPC_COMPRESS_THRESHOLD (default 256KiB)\n"
+	       "  --json                   one line of json instead of the table\n");
+}
+
+bool parseArgs(int argc, char **argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		auto next = [&]() {
+			++i;
+			return value != nullptr;
+		};
+
+		if (arg == "--transport" && next())
+			g_options.transport = value;
+		else if (arg == "--mode" && next())
+			g_options.mode = value;
+		else if (arg == "--traffic" && next())
+			g_options.traffic = value;
+		else if (arg == "--payload" && next())
+			g_options.payload = size_t(std::strtoull(value, nullptr, 10));
+		else if (arg == "--concurrency" && next())
+			g_options.concurrency = atoi(value);
+		else if (arg == "--requests" && next())
+			g_options.requests = atoi(value);
+		else if (arg == "--warmup" && next())
+			g_options.warmup = atoi(value);
+		else if (arg == "--processes" && next())
+			g_options.processes = atoi(value);
+		else if (arg == "--ring")
+			g_options.ring = true;
+		else if (arg == "--compress")
+			g_options.compress = true;
+		else if (arg == "--json")
+			g_options.json = true;
+		else
+			return false;
+	}
+
+	return (g_options.transport == "tcp" || g_options.transport == "unix") && (g_options.mode == "stream" || g_options.mode == "unary") &&
+	       (g_options.traffic == "api" || g_options.traffic == "javascript") && g_options.payload >= 2 && g_options.concurrency > 0 &&
+	       g_options.requests > 0 && g_options.warmup >= 0 && (g_options.processes == 1 || g_options.processes == 2);
+}
+
+void printResult(const Json &result)
+{
+	if (g_options.json)
+	{
+		printf("%s\n", result.dump().c_str());
+		return;
+	}
+
+	printf("transport %s, mode %s, traffic %s, payload %zu B, concurrency %d, processes %d, ring %s, compress %s\n", g_options.transport.c_str(),
+	       g_options.mode.c_str(), g_options.traffic.c_str(), g_options.payload, g_options.concurrency, g_options.processes, g_options.ring ? "on" : "off",
+	       g_options.compress ? "on" : "off");
+
+	printf("messages   %.0f in %.3f s, %.0f errors\n", result["messages"].number_value(), result["seconds"].number_value(), result["errors"].number_value());
+	printf("msgs/sec   %.1f\n", result["msgs_per_sec"].number_value());
+	printf("MiB/sec    %.2f\n", result["bytes_per_sec"].number_value() / (1024.0 * 1024.0));
+	printf("allocs/msg %.1f\n", result["allocs_per_msg"].number_value());
+
+	if (result["rtt_us"].is_object())
+	{
+		const Json &rtt = result["rtt_us"];
+		printf("rtt us     p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", rtt["p50"].number_value(), rtt["p90"].number_value(), rtt["p99"].number_value(),
+		       rtt["max"].number_value());
+	}
+}
+
+}
+
+void *operator new(size_t size)
+{
+	++g_allocations;
+
+	if (void *result = std::malloc(size != 0 ? size : 1))
+		return result;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+int main(int argc, char **argv)
+{
+	if (!parseArgs(argc, argv))
+	{
+		printUsage();
+		return 2;
+	}
+
+	std::string pluginAddress;
+	std::string browserAddress;
+
+	if (g_options.transport == "unix")
+	{
+		const std::string directory = std::filesystem::temp_directory_path().u8string();
+		pluginAddress = IpcEndpoint::unixSocket(directory, "sl-browser-bench-" + std::to_string(getpid()) + "-plugin.sock");
+		browserAddress = IpcEndpoint::unixSocket(directory, "sl-browser-bench-" + std::to_string(getpid()) + "-browser.sock");
+
+		if (pluginAddress.empty() || browserAddress.empty())
+		{
+			printf("Temp directory %s can't hold a unix socket path\n", directory.c_str());
+			return 1;
+		}
+	}
+	else
+	{
+		pluginAddress = IpcEndpoint::tcp(chooseTcpPort());
+		browserAddress = IpcEndpoint::tcp(chooseTcpPort());
+	}
+
+	// The plugin side stays in this process, so its pid names the ring either way
+	const uint32_t pluginPid = uint32_t(getpid());
+
+	// Split before grpc starts any threads of its own, fork doesn't carry those over
+	pid_t child = 0;
+
+	if (g_options.processes == 2)
+	{
+		child = fork();
+
+		if (child < 0)
+		{
+			perror("fork");
+			return 1;
+		}
+	}
+
+	const bool runPlugin = g_options.processes == 1 || child > 0;
+	const bool runBrowser = g_options.processes == 1 || child == 0;
+
+	PluginSide plugin;
+	BrowserSide browser;
+
+	if (runPlugin && !plugin.start(pluginAddress, browserAddress))
+	{
+		printf("Failed to start plugin side at %s\n", pluginAddress.c_str());
+
+		if (child > 0)
+			kill(child, SIGTERM);
+
+		return 1;
+	}
+
+	// Plugin side of a two process run just serves until the browser side is done
+	if (!runBrowser)
+	{
+		int status = 0;
+		waitpid(child, &status, 0);
+		plugin.stop();
+		IpcEndpoint::removeSocketFile(pluginAddress);
+		return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+	}
+
+	if (!browser.start(browserAddress, pluginAddress, pluginPid))
+	{
+		printf("Failed to start browser side at %s\n", browserAddress.c_str());
+		return 1;
+	}
+
+	Json::object result = g_options.traffic == "api" ? browser.runApi().object_items() : browser.runJavascript().object_items();
+
+	browser.disconnect();
+
+	if (runPlugin)
+	{
+		plugin.stop();
+		result["plugin"] = plugin.stats();
+		IpcEndpoint::removeSocketFile(pluginAddress);
+	}
+
+	browser.stop();
+
+	IpcEndpoint::removeSocketFile(browserAddress);
+
+	printResult(result);
+	return result["errors"].number_value() == 0 ? 0 : 1;
+}